@@ -0,0 +1,176 @@
+"""
+avrlink.py
+
+Serial link to the command line interface of the device (cmd.cpp).
+Used by the host tools in this folder to run commands the same way
+an operator would type them on the terminal.
+
+Requires pyserial.
+
+"""
+
+import time
+import urllib.parse
+
+import serial
+
+
+PROMPT = b'cmd@avr:~$ '
+ENDL = b'\r'
+
+# Printed once after every reset, before the first prompt (main(cmd).cpp).
+BANNER = b'AVR Database\r'
+
+# Default admin login, see ADMIN_ID and ADMIN_PW in cmd.h.
+ADMIN_ID = 1234
+ADMIN_PW = 1234
+
+# Field separators of the output modes (output.h).
+SEPARATORS = {'csv': ',', 'tsv': '\t', 'kv': ' '}
+
+
+def records(lines, mode='csv'):
+	"""
+	Splits the output lines of a command run in the csv, tsv or kv
+	output mode into records. Fields are unescaped (%XX).
+
+	@param: lines:	Output lines of the command, ending with the status line.
+	@param: mode:	Output mode the device is in.
+
+	@return:		List of records, each a list of fields (a dict in kv mode).
+					Raises IOError with the error of the status line.
+	"""
+	def field(text):
+		return urllib.parse.unquote_to_bytes(text).decode('latin-1')
+
+	separator = SEPARATORS[mode]
+	result = []
+	for line in lines:
+		fields = line.split(separator)
+		if mode == 'kv':
+			fields = {key: field(value) for key, value in (item.split('=', 1) for item in fields)}
+			status = [fields['status'], fields.get('error')] if 'status' in fields else None
+		else:
+			fields = [field(value) for value in fields]
+			status = fields if fields[0] in ('OK', 'ERR') else None
+		if status:
+			if status[0] != 'OK':
+				raise IOError(f'device error: {status[1]}')
+			return result
+		result.append(fields)
+	raise IOError('no status line')
+
+
+class Device:
+	"""
+	One serial connection to the device. The device echoes back every
+	character it reads through SIO::scanf, so every read in here is
+	done up to a known piece of text such as a prompt.
+	"""
+
+	def __init__(self, port, baud=9600, timeout=5.0, admin=(ADMIN_ID, ADMIN_PW)):
+		"""
+		@param: port:		Serial port or pty path of the device.
+		@param: baud:		Baud rate (BAUD in User.h).
+		@param: timeout:	Seconds to wait for any expected text.
+		@param: admin:		Admin ID and Password used for privileged commands.
+		"""
+		self.name = port
+		self.serial = serial.Serial(port, baud, timeout=timeout)
+		self.admin = admin
+
+	def close(self):
+		self.serial.close()
+
+	def write(self, data):
+		if isinstance(data, str):
+			data = data.encode('ascii')
+		self.serial.write(data)
+
+	def write_line(self, line):
+		self.write(line)
+		self.write(ENDL)
+
+	def read_until(self, token):
+		"""
+		Reads up to and including the given text and returns what was
+		read. Raises TimeoutError if the text does not arrive in time.
+		"""
+		data = self.serial.read_until(token)
+		if not data.endswith(token):
+			raise TimeoutError(f'{self.name}: expected {token!r}, got {data[-40:]!r}')
+		return data
+
+	def expect(self, *tokens):
+		"""
+		Reads until any of the given texts arrives.
+
+		@return:	(data read including the text, index of the text)
+		"""
+		data = bytearray()
+		deadline = time.monotonic() + self.serial.timeout
+		while time.monotonic() < deadline:
+			byte = self.serial.read(1)
+			if not byte:
+				continue
+			data += byte
+			for index, token in enumerate(tokens):
+				if data.endswith(token):
+					return bytes(data), index
+		raise TimeoutError(f'{self.name}: expected one of {tokens!r}, got {bytes(data[-40:])!r}')
+
+	def read_line(self):
+		"""Reads one '\\r' terminated line and returns it without the terminator."""
+		return self.read_until(ENDL)[:-1].decode('ascii', 'replace')
+
+	def sync(self):
+		"""
+		Brings the device to a fresh prompt. An empty command line makes
+		CMD::parse return and print the prompt again.
+		"""
+		self.serial.reset_input_buffer()
+		self.write(ENDL)
+		self.read_until(PROMPT)
+		# The prompt read may be one printed before the empty line (at
+		# boot), the one that answers it is then dropped as well.
+		time.sleep(0.1)
+		self.serial.reset_input_buffer()
+
+	def login_admin(self):
+		"""Answers the admin prompts of CMD::Admin."""
+		self.read_until(b'Enter Admin ID: ')
+		self.write_line(str(self.admin[0]))
+		self.read_until(b'Enter Admin Password: ')
+		self.write_line(str(self.admin[1]))
+		self.read_until(ENDL)
+
+	def start(self, command, admin=False):
+		"""
+		Types a command and consumes its echo. If the command requires
+		admin privileges the admin prompts are answered as well.
+		"""
+		self.write_line(command)
+		self.read_until(ENDL)
+		if admin:
+			self.login_admin()
+
+	def command(self, command, admin=False, answers=()):
+		"""
+		Runs a command to completion and returns its output lines.
+
+		@param: command:	Command line as typed on the terminal.
+		@param: admin:		Whether the command asks for admin login.
+		@param: answers:	(prompt, reply) pairs answered in order.
+
+		@return:			Output lines up to the next prompt.
+		"""
+		self.start(command, admin)
+		for prompt, reply in answers:
+			self.read_until(prompt.encode('ascii'))
+			self.write_line(str(reply))
+		data = self.read_until(PROMPT)[:-len(PROMPT)]
+		return [line for line in data.decode('ascii', 'replace').split('\r') if line]
+
+	def set_output(self, mode):
+		"""Switches the device to the text, csv, tsv or kv output mode."""
+		self.command(f'output {mode}')
@@ -0,0 +1,342 @@
+"""
+bench.py
+
+Throughput benchmark of the pipelined client (pipeline.py) against the
+one command at a time avrlink.Device. Both replay the same logins and
+the number of logins per second is reported for each.
+
+By default the device is simulated on a pty: a model of the command
+line with the prompts of 'user -l' and the sync protocol over a model
+of the EEPROM records (used by fleet.py), the receive ring of the firmware
+(RX_SIZE-1 bytes, later bytes are dropped), the time of every byte on the
+wire at the baud rate and a latency per direction such as that of a
+USB serial adapter. With --reset T the simulated device resets T
+seconds into the pipelined run, which the client has to recover from.
+The simulated device also answers 'user -s' and can run the keypad
+model of keypad.py. With --port a real device (or simavr) holding
+database.csv is used instead. For each run the bytes the receive ring
+dropped are read from the 'mem' report of the device (uart.dropped),
+so they are counted on a real device as well.
+
+Usage: python bench.py [--count 50] [--baud 9600] [--latency 0.016] [--reset T] [--port PORT]
+
+"""
+
+import argparse
+import collections
+import os
+import sys
+import threading
+import time
+import tty
+
+import avrlink
+import database
+import loadgen
+import pipeline
+import sync
+
+
+class Reset(Exception):
+	pass
+
+
+class SimDevice:
+	"""
+	Command line of the device on the master side of a pty. The model
+	runs in its own thread on a clock that never gets ahead of real
+	time: reading waits for a byte in the receive ring and sending
+	takes one byte time per byte.
+	"""
+
+	def __init__(self, users, baud=9600, latency=0.016, ring=pipeline.RX_SIZE, slots=64, pad=None, busy=True):
+		"""
+		@param: pad:	keypad.Pad stepped while waiting for input and,
+						with busy, while waiting for the transmitter.
+		"""
+		self.users = users
+		self.slots = slots
+		self.pad = pad
+		self.busy = busy
+		self.eeprom = bytearray(b'\xFF' * 16 * slots)
+		self.byte_time = 10 / baud
+		self.latency = latency
+		self.ring_size = ring
+		self.dropped = 0
+
+		self.master, slave = os.openpty()
+		tty.setraw(slave)
+		self.port = os.ttyname(slave)
+		self.slave = slave
+
+		self.lock = threading.Condition()
+		self.arriving = collections.deque()
+		self.ring = collections.deque()
+		self.leaving = collections.deque()
+		self.rx_free = 0.0
+		self.tx_free = 0.0
+		self.resetting = False
+		self.booting = False
+		self.closed = False
+		self.threads = [threading.Thread(target=target, daemon=True) for target in (self._wire, self._firmware)]
+		for thread in self.threads:
+			thread.start()
+
+	def close(self):
+		self.closed = True
+		with self.lock:
+			self.lock.notify_all()
+		for thread in self.threads:
+			thread.join()
+		os.close(self.master)
+		os.close(self.slave)
+
+	def reset(self):
+		"""Drops everything received and not sent yet and starts over."""
+		with self.lock:
+			self.arriving.clear()
+			self.ring.clear()
+			self.leaving.clear()
+			self.resetting = True
+			self.booting = True
+			self.lock.notify_all()
+
+	def _wire(self):
+		"""Moves bytes between the pty and the UART at wire speed."""
+		os.set_blocking(self.master, False)
+		while not self.closed:
+			now = time.monotonic()
+			try:
+				data = os.read(self.master, 256)
+			except BlockingIOError:
+				data = b''
+			with self.lock:
+				for byte in data:
+					self.rx_free = max(self.rx_free, now + self.latency) + self.byte_time
+					self.arriving.append((self.rx_free, byte))
+				while self.arriving and self.arriving[0][0] <= now:
+					_, byte = self.arriving.popleft()
+					if len(self.ring) < self.ring_size - 1:
+						self.ring.append(byte)
+						self.lock.notify_all()
+					else:
+						self.dropped += 1
+				out = bytearray()
+				while self.leaving and self.leaving[0][0] <= now:
+					out.append(self.leaving.popleft()[1])
+			if out:
+				os.write(self.master, bytes(out))
+			time.sleep(0.0005)
+
+	def receive(self):
+		with self.lock:
+			while not self.ring and not self.closed and not self.resetting:
+				# UART::idle
+				if self.pad:
+					self.pad.step()
+				self.lock.wait(0.002 if self.pad else 0.05)
+			if self.closed:
+				raise EOFError
+			if self.resetting:
+				self.resetting = False
+				raise Reset
+			return self.ring.popleft()
+
+	def send(self, data):
+		if isinstance(data, str):
+			data = data.encode('ascii')
+		now = time.monotonic()
+		with self.lock:
+			if self.resetting:
+				self.resetting = False
+				raise Reset
+			for byte in data:
+				self.tx_free = max(self.tx_free, now) + self.byte_time
+				self.leaving.append((self.tx_free + self.latency, byte))
+			wait = self.tx_free - now
+		# The firmware busy-waits on the transmitter, running UART::busy.
+		if wait > 0 and self.pad and self.busy:
+			end = now + wait
+			while (left := end - time.monotonic()) > 0:
+				self.pad.step()
+				time.sleep(min(left, self.byte_time))
+		elif wait > 0:
+			time.sleep(wait)
+
+	def scanf(self, echo=True):
+		line = bytearray()
+		while True:
+			byte = self.receive()
+			if byte == avrlink.ENDL[0]:
+				self.send(avrlink.ENDL)
+				return line.decode('ascii', 'replace')
+			self.send(bytes([byte]) if echo else b'*')
+			line.append(byte)
+
+	def _firmware(self):
+		while True:
+			try:
+				if self.booting:
+					self.booting = False
+					self.send(avrlink.ENDL + avrlink.BANNER)
+				self.send(avrlink.PROMPT)
+				argv = self.scanf().split()
+				if not argv:
+					continue
+				if argv[:2] == ['user', '-l']:
+					self._login()
+				elif argv[:2] in (['user', '-s'], ['user', '--show']):
+					if self._admin():
+						self._show()
+					else:
+						self.send('Not an admin.\r')
+				elif argv[:2] == ['sync', '--digest'] and self._admin():
+					self._digest()
+				elif argv[:2] == ['sync', '--apply'] and self._admin():
+					self._apply()
+				elif argv[0] == 'sync':
+					self.send('Not an admin.\r')
+				elif argv[0] == 'mem':
+					self.send(f'uart.dropped {self.dropped}\r')
+				else:
+					self.send(f"'{argv[0]}' is not recognized as a command.\rType 'help' for an overview of all the commands.\r")
+			except Reset:
+				continue
+			except EOFError:
+				return
+
+	def _admin(self):
+		self.send('Enter Admin ID: ')
+		ID = self.scanf()
+		self.send('Enter Admin Password: ')
+		PW = self.scanf(echo=False)
+		return (ID, PW) == (str(avrlink.ADMIN_ID), str(avrlink.ADMIN_PW))
+
+	def _record_digest(self, slot):
+		return sync.record_digest(self.eeprom, slot)
+
+	def _table_digest(self):
+		return database.table_digest([self._record_digest(slot) for slot in range(self.slots)])
+
+	def _digest(self):
+		for slot in range(self.slots):
+			self.send(f'{self._record_digest(slot):04X}\r')
+		self.send(f'DIGEST {self._table_digest():04X}\r')
+
+	def _apply(self):
+		self.send('READY\r')
+		count = 0
+		while True:
+			line = bytearray()
+			while (byte := self.receive()) != avrlink.ENDL[0]:
+				line.append(byte)
+			if not line:
+				break
+			try:
+				record = bytes.fromhex(line.decode('ascii'))
+			except ValueError:
+				record = b''
+			if len(record) != 17 or record[0] >= self.slots:
+				self.send('!')
+				continue
+			# DB::Write only writes the bytes that changed, 3.4 ms each.
+			old = self.eeprom[record[0]*16:record[0]*16+16]
+			time.sleep(0.0034 * sum(a != b for a, b in zip(old, record[1:])))
+			self.eeprom[record[0]*16:record[0]*16+16] = record[1:]
+			self.send('+')
+			count += 1
+		self.send(f'\rAPPLIED {count}\r')
+		self.send(f'DIGEST {self._table_digest():04X}\r')
+
+	def _show(self):
+		self.send('User Database:\r')
+		for ID in sorted(self.users):
+			self.send(f'\rID: {ID}\rData: user_{ID:05}\rPassword: {self.users[ID]}\r')
+
+	def _login(self):
+		self.send(loadgen.ID_PROMPT)
+		ID = int(self.scanf() or -1)
+		if ID not in self.users:
+			self.send(loadgen.NOT_FOUND)
+			return
+		self.send(loadgen.PW_PROMPT)
+		PW = int(self.scanf(echo=False) or -1)
+		if PW == self.users[ID]:
+			self.send(loadgen.COMPLETE)
+			self.send(f'User ID: {ID}\rData: user_{ID:05}\r')
+		else:
+			self.send(loadgen.FAILED)
+
+
+def answers(users, ID, PW):
+	"""Lines read by 'user -l': the Password only for an existing User."""
+	return [ID, PW] if ID in users else [ID]
+
+
+def dropped(device, before=0):
+	"""
+	Bytes the receive ring of the device dropped since before, from the
+	'mem' report (uart.dropped). A reset starts the count over.
+	"""
+	count = loadgen.read_mem(device)['uart.dropped']
+	return count - before if count >= before else count
+
+
+def sequential(port, baud, logins, users, reset=None):
+	"""@return:	Seconds taken and bytes the device dropped."""
+	device = avrlink.Device(port, baud)
+	try:
+		device.sync()
+		before = dropped(device)
+		start = time.monotonic()
+		for _, ID, PW in logins:
+			loadgen.login(device, None, ID, PW)
+		duration = time.monotonic() - start
+		return duration, dropped(device, before)
+	finally:
+		device.close()
+
+
+def pipelined(port, baud, logins, users, reset=None):
+	"""@return:	Seconds taken and bytes the device dropped."""
+	with pipeline.Client(port, baud) as client:
+		before = dropped(client)
+		start = time.monotonic()
+		if reset:
+			threading.Timer(reset[0], reset[1]).start()
+		futures = [client.submit('user -l', answers=answers(users, ID, PW)) for _, ID, PW in logins]
+		for future in futures:
+			future.result()
+		if client.resets:
+			print(f'pipelined: recovered from {client.resets} reset(s)')
+		duration = time.monotonic() - start
+		return duration, dropped(client, before)
+
+
+if __name__ == '__main__':
+
+	parser = argparse.ArgumentParser(description='Compare sequential and pipelined command throughput.')
+	parser.add_argument('--csv', default='database.csv')
+	parser.add_argument('--count', type=int, default=50)
+	parser.add_argument('--baud', type=int, default=9600)
+	parser.add_argument('--latency', type=float, default=0.016, help='seconds per direction of the simulated link (USB adapter latency timer)')
+	parser.add_argument('--reset', type=float, help='reset the simulated device this many seconds into the pipelined run')
+	parser.add_argument('--port', help='real device instead of the simulation')
+	args = parser.parse_args()
+
+	users = loadgen.load_users(args.csv)
+	logins = loadgen.make_logins(users, args.count, (8, 1, 1), seed=1)
+
+	for name, run in (('sequential', sequential), ('pipelined', pipelined)):
+		device = None if args.port else SimDevice(users, args.baud, args.latency)
+		port = args.port or device.port
+		try:
+			reset = (args.reset, device.reset) if device and args.reset and run is pipelined else None
+			duration, lost = run(port, args.baud, logins, users, reset)
+		except (IOError, TimeoutError) as error:
+			print(f'{name}: {error}')
+			sys.exit(1)
+		finally:
+			if device:
+				device.close()
+		print(f'{name:10}  {len(logins)/duration:6.1f} logins/s  ({duration:.2f} s)  {lost} bytes dropped')
@@ -14,8 +14,11 @@
 
 :: Creates the .eep file. If the intent is to run
 :: on hardware then this file (only .eep) is enough.
+:: Users marked 'flash' in the CSV are written to the
+:: program memory table (src/flashdb.cpp) instead.
 call python database.py
 echo database.eep created.
+echo ..\src\flashdb.cpp created, rebuild the firmware if it changed.
 
 :: Creates the .bin file. This file is required by Proteus 
 :: Simulation Software for simulating the initial contents 
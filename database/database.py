@@ -11,11 +11,217 @@ ID in first column, user Passwords in second column and user
 data in third column. By default the first row of CSV will be 
 ignored.
 
+The target board is selected with --mcu (default atmega328p), --audit
+if the firmware is built with AUDIT and --wear if it is built with
+WEAR_COUNTERS. These decide how many Users fit in EEPROM, see board.h
+and User.h.
+
+An optional fourth column 'flash' puts a User in the read-only table
+in program memory instead (flashdb.h). Users whose ID does not fit in
+EEPROM go there as well. The table is written to ../src/flashdb.cpp,
+so the firmware has to be rebuilt when it changes.
+
+With --banks (firmware built with DB_BANKS) the records go to bank A
+and the bank header is written with generation 0 and the CRC of bank A,
+so the device serves bank A after programming.
+
+With --extents (firmware built with DB_EXTENTS) every User gets an 8 byte
+header and its Data, up to 40 bytes, goes to an extent of EEPROM blocks
+right after the headers, so a User takes only the space of its Data.
+The number of headers is that of 24 byte Users though, and IDs past it
+go to program memory, where Data longer than 10 bytes is cut (with a
+warning).
+
 """
 
+import argparse
 import csv
 
 
+# EEPROM size and audit log size of each board profile (board.h).
+PROFILES = {
+	'atmega328p':  {'eeprom': 1024, 'audit': 128},
+	'atmega1284p': {'eeprom': 4096, 'audit': 512},
+	'atmega2560':  {'eeprom': 4096, 'audit': 512},
+}
+
+
+def reserved(mcu, audit=False, wear=False):
+	"""
+	Bytes at the end of EEPROM that do not hold Users: the audit log
+	(AUDIT_SIZE) and the write counters, two bytes per 16 byte region
+	(WEAR_SIZE in User.h).
+
+	@param: mcu:	Board profile name (see PROFILES).
+	@param: audit:	Whether the firmware reserves the audit log region.
+	@param: wear:	Whether the firmware keeps write counters (WEAR_COUNTERS).
+
+	@return:		Number of bytes.
+	"""
+	profile = PROFILES[mcu]
+	size = profile['audit'] if audit else 0
+	if wear:
+		size += 2 * (profile['eeprom'] // 16)
+	return size
+
+
+def capacity(mcu, audit=False, banks=False, wear=False, extents=False):
+	"""
+	Number of Users that fit in EEPROM of the given board (USER_COUNT
+	in User.h). The ID is one byte and 0xFF marks an empty record, so
+	there are never more than 255.
+
+	@param: mcu:	Board profile name (see PROFILES).
+	@param: audit:	Whether the firmware reserves the audit log region.
+	@param: banks:	Whether the firmware keeps two banks (DB_BANKS).
+	@param: wear:	Whether the firmware keeps write counters (WEAR_COUNTERS).
+	@param: extents:Whether the Data is kept in extents (DB_EXTENTS).
+
+	@return:		Number of Users.
+	"""
+	space = PROFILES[mcu]['eeprom'] - reserved(mcu, audit, wear)
+	if extents:
+		return min(255, space // (EXTENT_HEADER + EXTENT_AVERAGE))
+	if banks:
+		return min(255, (space - 16) // 32)
+	return min(255, space // 16)
+
+
+def id_ranges(ids):
+	"""Sorted IDs as a short text, e.g. '3, 56-59'."""
+	ranges = []
+	for ID in sorted(ids):
+		if ranges and ranges[-1][1] == ID - 1:
+			ranges[-1][1] = ID
+		else:
+			ranges.append([ID, ID])
+	return ', '.join(str(a) if a == b else f'{a}-{b}' for a, b in ranges)
+
+
+# Extents (DB_EXTENTS in User.h): size of the record header, bytes of
+# Data the space is split for, and the most Data of one User.
+EXTENT_HEADER = 8
+EXTENT_AVERAGE = 16
+DATA_SIZE = 40
+
+
+def extent_layout(mcu, audit=False, wear=False):
+	"""
+	Where the extents are kept with DB_EXTENTS (EXTENT_BASE, EXTENT_BLOCK
+	and EXTENT_BLOCKS in User.h).
+
+	@param: mcu:	Board profile name (see PROFILES).
+	@param: audit:	Whether the firmware reserves the audit log region.
+	@param: wear:	Whether the firmware keeps write counters (WEAR_COUNTERS).
+
+	@return:		Dictionary of the first address, the block size and the
+					number of blocks.
+	"""
+	space = PROFILES[mcu]['eeprom'] - reserved(mcu, audit, wear)
+	base = capacity(mcu, audit, False, wear, True) * EXTENT_HEADER
+	block = 8 if PROFILES[mcu]['eeprom'] > 1024 else 4
+	return {'base': base, 'block': block, 'blocks': min(255, (space - base) // block)}
+
+
+def extent_record(ID, PW, DT, block):
+	"""
+	Header of a User with DB_EXTENTS: ID, Password, length of the Data,
+	first block of its extent and the status byte (live).
+
+	@return:		The 8 header bytes.
+	"""
+	length = len(DT)
+	return bytearray([ID & 0xFF]) + PW.to_bytes(4, 'little') + bytearray([length, block if length else 0xFF, 0x00])
+
+
+def bank_header(mcu, audit=False, wear=False):
+	"""
+	EEPROM address of the bank header (BANK_HEADER in User.h), the
+	16 bytes right before the reserved regions.
+
+	@param: mcu:	Board profile name (see PROFILES).
+	@param: audit:	Whether the firmware reserves the audit log region.
+	@param: wear:	Whether the firmware keeps write counters (WEAR_COUNTERS).
+
+	@return:		Address of the header.
+	"""
+	return PROFILES[mcu]['eeprom'] - reserved(mcu, audit, wear) - 16
+
+
+def crc16(data, crc=0xFFFF):
+	"""Same CRC-16 as _crc16_update in avr-libc (polynomial 0xA001)."""
+	for byte in data:
+		crc ^= byte
+		for _ in range(8):
+			crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+	return crc
+
+
+def table_digest(digests):
+	"""Digest of the whole table as calculated by DB::Digest()."""
+	crc = 0xFFFF
+	for digest in digests:
+		crc = crc16(bytearray([digest & 0xFF, digest >> 8]), crc)
+	return crc
+
+
+def hex_line(address, data):
+	"""
+	Generates one Intel Hex data record for the given bytes.
+
+	@param: address:	Start address.
+	@param: data:		Bytes of the record (at most 255).
+
+	@return:			The record including checksum and newline.
+	"""
+	raw = bytearray([len(data), (address >> 8) & 0xFF, address & 0xFF, 0x00]) + bytearray(data)
+	return ':' + raw.hex().upper() + '%02X' % (-sum(raw) & 0xFF) + '\n'
+
+
+# User IDs of the program memory table are below this (User.h). ID
+# 255 reads as an empty record and can not be used.
+FLASH_ID_LIMIT = 4096
+
+
+def flash_table(users, path):
+	"""
+	Writes the program memory table (flashdb.h) as a C++ source file.
+	The table is sorted by ID because the firmware searches it with a
+	binary search. Data is truncated or padded with zeros to 10 bytes
+	like in the EEPROM records.
+
+	@param: users:	List of (ID, PW, DT) tuples.
+	@param: path:	Path of the generated source file.
+	"""
+	lines = [
+		'/*',
+		' * flashdb.cpp',
+		' *',
+		' * Generated by database.py from database.csv. Do not edit, edit',
+		' * the CSV file and run database.bat (or database.py) instead.',
+		' */ ',
+		'',
+		'#include "flashdb.h"',
+		'',
+		'',
+		f'const unsigned int flash_count = {len(users)};',
+		'',
+		'const FlashUser flash_users[] PROGMEM =',
+		'{',
+	]
+	for ID, PW, DT in sorted(users):
+		data = [ord(c) & 0xFF for c in DT[:10]]
+		data += [0] * (10 - len(data))
+		data = ', '.join(f'0x{b:02X}' for b in data)
+		lines.append(f'\t{{{ID}, {PW}L, {{{data}}}}},')
+	# The array must not be empty, the sentinel is never read.
+	if not users:
+		lines.append('\t{0xFFFF, 0L, {0}}')
+	lines.append('};')
+	with open(path, 'w', newline='\r\n') as file:
+		file.write('\n'.join(lines) + '\n')
+
+
 def record(ID, PW, DT, reclen='10', rectype='00'):
 	"""
 	Generates a record entry to be stored in eep file. This entry
@@ -125,6 +331,21 @@ def record(ID, PW, DT, reclen='10', rectype='00'):
 
 if __name__ == '__main__':
 
+	parser = argparse.ArgumentParser(description='Generate database.eep from database.csv.')
+	parser.add_argument('--mcu', default='atmega328p', choices=sorted(PROFILES))
+	parser.add_argument('--audit', action='store_true', help='firmware is built with AUDIT')
+	parser.add_argument('--banks', action='store_true', help='firmware is built with DB_BANKS')
+	parser.add_argument('--wear', action='store_true', help='firmware is built with WEAR_COUNTERS')
+	parser.add_argument('--extents', action='store_true', help='firmware is built with DB_EXTENTS')
+	parser.add_argument('--flash', default='../src/flashdb.cpp', help='generated program memory table')
+	args = parser.parse_args()
+	if args.extents and args.banks:
+		parser.error('--extents can not be combined with --banks')
+	users = capacity(args.mcu, args.audit, args.banks, args.wear, args.extents)
+	layout = extent_layout(args.mcu, args.audit, args.wear) if args.extents else None
+	next_block = 0
+	eeprom = PROFILES[args.mcu]['eeprom']
+
 	# Import the CSV data.
 	file = open('database.csv', 'r')
 	reader = csv.reader(file, delimiter = ',')
@@ -140,6 +361,13 @@ if __name__ == '__main__':
 	# hexx = open("database.hex", "w")
 	i = 0
 	bytes = 0
+	flash = []
+	# IDs that fit the board without the options but not with them.
+	displaced = []
+	# IDs in program memory whose Data is longer than the 10 bytes kept there.
+	truncated = []
+	# Record digests of bank A for the bank header, empty slots are erased.
+	digests = [crc16(b'\xFF' * 16)] * users
 	print("Intel Hex:")
 	for row in reader:
 		# Skip the first row of csv.
@@ -147,22 +375,66 @@ if __name__ == '__main__':
 			i += 1
 			continue
 
+		# Address is generated from User ID, so an ID beyond the
+		# capacity of the board has no place in EEPROM and goes to
+		# the program memory table, as do the Users marked 'flash'.
+		if int(row[0]) >= users or (len(row) > 3 and row[3].strip().lower() == 'flash'):
+			if int(row[0]) >= FLASH_ID_LIMIT or int(row[0]) == 0xFF:
+				print(f'User ID {row[0]} can not be stored. User skipped.')
+			else:
+				flash.append((int(row[0]), int(row[1]), row[2]))
+				if users <= int(row[0]) < capacity(args.mcu):
+					displaced.append(int(row[0]))
+				if len(row[2]) > 10:
+					truncated.append(int(row[0]))
+			continue
+
+		# With extents the header and the blocks of the Data are taken
+		# one after the other.
+		if layout:
+			DT = row[2].encode('latin-1')[:DATA_SIZE]
+			count = -(-len(DT) // layout['block'])
+			if next_block + count > layout['blocks']:
+				print('EEPROM memory exceeded. Some data is lost.')
+				break
+			header = extent_record(int(row[0]), int(row[1]), DT, next_block)
+			lines = hex_line(int(row[0]) * EXTENT_HEADER, header)
+			if DT:
+				lines += hex_line(layout['base'] + next_block * layout['block'], DT)
+			eep.write(lines)
+			print(lines, end='')
+			next_block += count
+			bytes += EXTENT_HEADER + count * layout['block']
+			i += 1
+			continue
+
 		# Addition of each entry increases the EEPROM utilization by
 		# 16 bytes.
 		bytes+=16
 
 		# If the memory is exceeded then the rest of the database is
 		# not generated.
-		if bytes > 1024:
+		if bytes > users*16:
 			print('EEPROM memory exceeded. Some data is lost.')
 			break
 
 		# Generate the records and save them in appropriate files.
-		eep.write(record(ID = int(row[0]), PW = int(row[1]), DT=row[2]+'\0'))
-		# hexx.write(record(ID = int(row[0]), PW = int(row[1]), DT=row[2]+'\0'))
-		print(record(ID = int(row[0]), PW = int(row[1]), DT=row[2]+'\0'), end='')
+		line = record(ID = int(row[0]), PW = int(row[1]), DT=row[2]+'\0')
+		eep.write(line)
+		# hexx.write(line)
+		print(line, end='')
+		# The 16 bytes of the record follow ':', length, address and type.
+		digests[int(row[0])] = crc16(bytearray.fromhex(line[9:41]))
 		i += 1
 
+	# Bank header: generation 0 and CRC of bank A. Bank B is left
+	# erased, its CRC does not match, so the device serves bank A.
+	if args.banks:
+		digest = table_digest(digests)
+		header = hex_line(bank_header(args.mcu, args.audit, args.wear), [0x00, digest & 0xFF, digest >> 8])
+		eep.write(header)
+		print(header, end='')
+
 	# End of File Record.
 	eep.write(":00000001FF")
 	eep.close()
@@ -171,6 +443,20 @@ if __name__ == '__main__':
 	file.close()
 	print(":00000001FF")
 
+	# Program memory table.
+	flash_table(flash, args.flash)
+
 	# Print the size of data and utilization of EEPROM.
 	print(f'\n{bytes} bytes of data generated for EEPROM.')
-	print(f'{(bytes/1024)*100}% memory reached.')
+	print(f'{(bytes/eeprom)*100}% memory reached.')
+	print(f'{len(flash)*16} bytes of data generated for program memory ({args.flash}).')
+
+	# The options take EEPROM from the User table, say which Users that
+	# moved to program memory, where they can not be changed on the device.
+	if displaced:
+		options = ' '.join(f'--{name}' for name in ('audit', 'banks', 'wear', 'extents') if getattr(args, name))
+		print(f'\nWarning: {args.mcu} has {users} User slots with {options}. User IDs {id_ranges(displaced)} '
+			f'were moved to the program memory table.')
+	if truncated:
+		print(f'\nWarning: the Data of User IDs {id_ranges(truncated)} was cut to the 10 bytes kept in the program '
+			f'memory table.')
@@ -0,0 +1,178 @@
+"""
+fleet.py
+
+Provisions many devices at once over their serial ports. Every device
+gets its own worker, so the total time is that of the slowest device
+instead of the sum of all of them.
+
+Jobs (--job):
+	import	Sends every record of database.eep and verifies the table.
+	verify	Only compares the digests of the device with the image.
+	sync	Sends the records that differ (delta sync) and verifies.
+
+Devices are the ports given on the command line, the ports found by
+--discover (those whose name or description contains the pattern) or
+N simulated devices on ptys with --sim N (see bench.py). A job that
+fails (timeout, rejected record, digest mismatch, lost port) is run
+again up to --retries times, then the device is reported as failed.
+
+Usage: python fleet.py [PORT ...] [--discover USB] [--sim N] [--job sync] [--workers 8] [--retries 2]
+
+"""
+
+import argparse
+import concurrent.futures
+import sys
+import threading
+import time
+
+import serial
+import serial.tools.list_ports
+
+import avrlink
+import database
+import sync
+
+
+class Result:
+
+	def __init__(self, port):
+		self.port = port
+		self.ok = False
+		self.attempts = 0
+		self.sent = 0
+		self.seconds = 0.0
+		self.error = ''
+
+
+def verify(device, image):
+	"""
+	Compares every record digest of the device with the image.
+
+	@return:	Number of records that differ.
+	"""
+	digests, total = sync.read_digests(device)
+	expected = database.table_digest([sync.record_digest(image, slot) for slot in range(len(digests))])
+	differ = len(sync.changed_slots(image, digests))
+	if not differ and total != expected:
+		raise IOError(f'{device.name}: table digest {total:04X} != {expected:04X}')
+	return differ
+
+
+def run_job(job, device, image):
+	"""
+	Runs one job on a connected device.
+
+	@return:	Number of records sent.
+	"""
+	device.sync()
+	if job == 'verify':
+		differ = verify(device, image)
+		if differ:
+			raise IOError(f'{device.name}: {differ} records differ from the image')
+		return 0
+	if job == 'import':
+		digests, _ = sync.read_digests(device)
+		slots = list(range(len(digests)))
+		sync.push(device, image, slots)
+	else:
+		slots = sync.delta_sync(device, image)
+	differ = verify(device, image)
+	if differ:
+		raise IOError(f'{device.name}: {differ} records differ after {job}')
+	return len(slots)
+
+
+def provision(port, job, image, baud, timeout, retries):
+	"""Runs a job on one device with retries and returns its Result."""
+	result = Result(port)
+	start = time.monotonic()
+	while result.attempts <= retries:
+		result.attempts += 1
+		device = None
+		try:
+			device = avrlink.Device(port, baud, timeout)
+			result.sent += run_job(job, device, image)
+			result.ok = True
+			break
+		except (IOError, TimeoutError, ValueError, serial.SerialException) as error:
+			result.error = str(error)
+			time.sleep(0.5)
+		finally:
+			if device:
+				device.close()
+	result.seconds = time.monotonic() - start
+	return result
+
+
+def discover(pattern):
+	"""Serial ports whose device name or description contains the pattern."""
+	return [port.device for port in serial.tools.list_ports.comports() if pattern in port.device or pattern in (port.description or '')]
+
+
+def report(results, job, wall):
+	print(f'{"port":16} {"result":7} {"tries":>5} {"sent":>5} {"time":>7}')
+	for result in sorted(results, key=lambda result: result.port):
+		line = f'{result.port:16} {"ok" if result.ok else "FAILED":7} {result.attempts:5} {result.sent:5} {result.seconds:6.1f}s'
+		if not result.ok:
+			line += f'  {result.error}'
+		print(line)
+	ok = sum(result.ok for result in results)
+	slowest = max((result.seconds for result in results), default=0)
+	total = sum(result.seconds for result in results)
+	print(f'{job}: {ok} of {len(results)} devices ok in {wall:.1f} s '
+		f'(slowest device {slowest:.1f} s, {total:.1f} s one after another).')
+
+
+if __name__ == '__main__':
+
+	parser = argparse.ArgumentParser(description='Provision many devices concurrently.')
+	parser.add_argument('ports', nargs='*', help='serial ports of the devices')
+	parser.add_argument('--discover', metavar='PATTERN', help='add the ports matching the pattern')
+	parser.add_argument('--sim', type=int, default=0, metavar='N', help='add N simulated devices')
+	parser.add_argument('--sim-reset', type=int, default=0, metavar='M', help='reset M of the simulated devices during the job')
+	parser.add_argument('--job', default='sync', choices=['import', 'verify', 'sync'])
+	parser.add_argument('--eep', default='database.eep', help='EEPROM image generated by database.py')
+	parser.add_argument('--mcu', default='atmega328p', choices=sorted(database.PROFILES))
+	parser.add_argument('--audit', action='store_true', help='firmware is built with AUDIT')
+	parser.add_argument('--wear', action='store_true', help='firmware is built with WEAR_COUNTERS')
+	parser.add_argument('--extents', action='store_true', help='firmware is built with DB_EXTENTS')
+	parser.add_argument('--baud', type=int, default=9600)
+	parser.add_argument('--workers', type=int, default=0, help='concurrent jobs, default one per device')
+	parser.add_argument('--retries', type=int, default=2)
+	parser.add_argument('--timeout', type=float, default=5.0, help='seconds to wait for any reply')
+	args = parser.parse_args()
+
+	if args.sim and args.extents:
+		parser.error('the simulated devices have no extents')
+	layout = database.extent_layout(args.mcu, args.audit, args.wear) if args.extents else None
+	image = sync.load_image(args.eep, database.PROFILES[args.mcu]['eeprom'], layout)
+	ports = list(args.ports)
+	if args.discover:
+		ports += discover(args.discover)
+
+	sims = []
+	if args.sim:
+		import bench
+		import loadgen
+		users = loadgen.load_users('database.csv')
+		slots = database.capacity(args.mcu)
+		sims = [bench.SimDevice(users, args.baud, slots=slots) for _ in range(args.sim)]
+		ports += [sim.port for sim in sims]
+		for sim in sims[:args.sim_reset]:
+			threading.Timer(1.0, sim.reset).start()
+	if not ports:
+		print('No devices.')
+		sys.exit(1)
+
+	start = time.monotonic()
+	try:
+		with concurrent.futures.ThreadPoolExecutor(max_workers=args.workers or len(ports)) as pool:
+			jobs = [pool.submit(provision, port, args.job, image, args.baud, args.timeout, args.retries) for port in ports]
+			results = [job.result() for job in jobs]
+	finally:
+		for sim in sims:
+			sim.close()
+	report(results, args.job, time.monotonic() - start)
+	if not all(result.ok for result in results):
+		sys.exit(1)
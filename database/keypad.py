@@ -0,0 +1,200 @@
+"""
+keypad.py
+
+Model of the PIN pad door terminal (keypad.h) for testing on the host.
+Keys go through the same steps as PAD::Step: the User ID and '#', then
+for an existing User the PIN and '#'. '*' starts over and an entry left
+for KEYPAD_TIMEOUT seconds is dropped. Pressed keys wait in a ring of
+KEYPAD_RING keys, later ones are lost as on the device.
+
+The model runs in the simulated device of bench.py, which steps it
+while the command line waits for input (UART::idle) and while it waits
+for the transmitter (UART::busy). The test runs 'user -s' listings on
+the UART while a door enters logins at human speed, and reports how
+long each login took from its last '#' to the result on the LCD. With
+--no-busy the transmitter hook is left out, so the door waits for the
+listing to end, as it would without it.
+
+Usage: python keypad.py [--logins 10] [--key-time 0.15] [--listings 3] [--baud 9600] [--no-busy]
+
+"""
+
+import argparse
+import collections
+import sys
+import threading
+import time
+
+import avrlink
+import loadgen
+
+
+# See keypad.h and User.h.
+KEYPAD_RING = 8
+KEYPAD_TIMEOUT = 10
+KEYPAD_DIGITS = 9
+FLASH_ID_LIMIT = 4096
+
+
+class Pad:
+	"""PAD::Step over the users of the simulated device."""
+
+	def __init__(self, users):
+		self.users = users
+		self.keys = collections.deque()
+		self.dropped = 0
+		self.lcd = ['', '']
+		self.state = 'idle'
+		self.number = 0
+		self.digits = 0
+		self.user_id = 0
+		self.last_key = 0.0
+		self.results = []
+
+	def press(self, key):
+		"""Called by the door. The key is lost if the ring is full."""
+		if len(self.keys) >= KEYPAD_RING - 1:
+			self.dropped += 1
+		else:
+			self.keys.append(key)
+
+	def _start(self, label):
+		self.lcd = [label, '']
+		self.number = 0
+		self.digits = 0
+
+	def _result(self, ID, result, lcd):
+		self.lcd = lcd
+		self.state = 'idle'
+		self.results.append((time.monotonic(), ID, result))
+
+	def step(self):
+		now = time.monotonic()
+		if self.state != 'idle' and now - self.last_key >= KEYPAD_TIMEOUT:
+			self.lcd = ['', '']
+			self.state = 'idle'
+		while self.keys:
+			key = self.keys.popleft()
+			self.last_key = now
+			if key == '*':
+				self._start('ID: ')
+				self.state = 'id'
+			elif key == '#':
+				if self.state == 'id':
+					self.user_id = self.number
+					if self.user_id >= FLASH_ID_LIMIT or self.user_id not in self.users:
+						self._result(self.user_id, 'no user', ['No user', ''])
+					else:
+						self.lcd[1] = 'PIN: '
+						self.number = 0
+						self.digits = 0
+						self.state = 'pin'
+				elif self.state == 'pin':
+					if self.users.get(self.user_id) == self.number:
+						self._result(self.user_id, 'ok', [f'ID: {self.user_id}', f'DATA: user_{self.user_id:05}'[:16]])
+					else:
+						self._result(self.user_id, 'denied', ['Denied', ''])
+			else:
+				if self.state == 'idle':
+					self._start('ID: ')
+					self.state = 'id'
+				if self.digits < KEYPAD_DIGITS:
+					self.number = self.number*10 + int(key)
+					self.digits += 1
+					if self.state == 'pin':
+						self.lcd[1] += '*'
+					else:
+						self.lcd[0] += key
+
+
+def door(pad, logins, key_time, timeout=30.0):
+	"""
+	Enters the logins one after another, a key every key_time seconds.
+
+	@return:	List of (kind, ID, result, seconds from the last '#' to
+				the result), result is None if none came in time.
+	"""
+	outcomes = []
+	for kind, ID, PW in logins:
+		keys = f'{ID}#' if kind == 'nonexistent' else f'{ID}#{PW}#'
+		count = len(pad.results)
+		for key in keys:
+			time.sleep(key_time)
+			pressed = time.monotonic()
+			pad.press(key)
+		deadline = pressed + timeout
+		while len(pad.results) == count and time.monotonic() < deadline:
+			time.sleep(0.001)
+		if len(pad.results) > count:
+			done, _, result = pad.results[count]
+			outcomes.append((kind, ID, result, done - pressed))
+		else:
+			# Lost keys leave the entry unfinished, start over.
+			pad.press('*')
+			outcomes.append((kind, ID, None, timeout))
+	return outcomes
+
+
+def listings(port, baud, count):
+	"""Runs 'user -s' count times and returns the duration of each."""
+	device = avrlink.Device(port, baud, timeout=60.0)
+	durations = []
+	try:
+		device.sync()
+		for _ in range(count):
+			start = time.monotonic()
+			device.command('user -s', admin=True)
+			durations.append(time.monotonic() - start)
+	finally:
+		device.close()
+	return durations
+
+
+def report(outcomes, durations, dropped):
+	"""
+	Prints every door login and a summary.
+
+	@return:	Number of logins with a wrong or missing result.
+	"""
+	expected = {'valid': 'ok', 'invalid': 'denied', 'nonexistent': 'no user'}
+	wrong = 0
+	print(f'{"kind":12} {"ID":>4} {"result":8} {"time":>8}')
+	for kind, ID, result, seconds in outcomes:
+		bad = result != expected[kind]
+		wrong += bad
+		print(f'{kind:12} {ID:4} {result or "-":8} {seconds*1000:6.1f} ms' + ('  WRONG' if bad else ''))
+	times = [seconds for _, _, result, seconds in outcomes if result]
+	if times:
+		print(f'door: p50 {loadgen.percentile(times, 50)*1000:.1f} ms, max {max(times)*1000:.1f} ms, '
+			f'{wrong} of {len(outcomes)} wrong, {dropped} keys dropped')
+	print('listings: ' + ', '.join(f'{seconds:.1f} s' for seconds in durations))
+	return wrong
+
+
+if __name__ == '__main__':
+
+	parser = argparse.ArgumentParser(description='Door logins on the keypad model during UART listings.')
+	parser.add_argument('--csv', default='database.csv')
+	parser.add_argument('--logins', type=int, default=10)
+	parser.add_argument('--key-time', type=float, default=0.15, help='seconds between two key presses')
+	parser.add_argument('--listings', type=int, default=3, help="'user -s' runs on the UART meanwhile")
+	parser.add_argument('--baud', type=int, default=9600)
+	parser.add_argument('--no-busy', action='store_true', help='step the keypad only while waiting for input')
+	args = parser.parse_args()
+
+	import bench
+
+	users = loadgen.load_users(args.csv)
+	logins = loadgen.make_logins(users, args.logins, (8, 1, 1), seed=1)
+	pad = Pad(users)
+	device = bench.SimDevice(users, args.baud, pad=pad, busy=not args.no_busy)
+	try:
+		durations = []
+		uart = threading.Thread(target=lambda: durations.extend(listings(device.port, args.baud, args.listings)))
+		uart.start()
+		outcomes = door(pad, logins, args.key_time)
+		uart.join()
+	finally:
+		device.close()
+	if report(outcomes, durations, pad.dropped):
+		sys.exit(1)
@@ -0,0 +1,235 @@
+"""
+loadgen.py
+
+End-to-end authentication load generator. Replays a mix of valid,
+invalid (wrong password) and nonexistent logins through 'user -l' at
+a given rate and reports throughput, latency percentiles and the number
+of bytes the device dropped. Every stage of a login is included: the
+prompts, the ID parse, DB::Read, the password check, SIO::printf(User)
+and DB::display.
+
+The device can be real hardware, the Proteus model through a virtual
+COM port, or a simavr instance exposing its UART on a pty. Credentials
+are taken from database.csv, so the device should hold that database.
+
+With --scan N the 'user -s' listing is timed N times as well, which
+is the cost of a full table scan on the board profile (--mcu).
+
+With --mem the SRAM report of the 'mem' command is taken before and
+after the run, which shows leaks and the stack/heap gap under load.
+
+Usage: python loadgen.py PORT [--rate 2] [--count 100] [--mix 8,1,1] [--mem]
+
+"""
+
+import argparse
+import csv
+import random
+import statistics
+import sys
+import time
+
+import avrlink
+import database
+
+
+# See msc_1 to msc_5 in cmd.h.
+ID_PROMPT = b'Enter User ID: '
+PW_PROMPT = b'Enter User Password: '
+NOT_FOUND = b'User does not exist.\r'
+COMPLETE = b'Authentication Complete.\r'
+FAILED = b'Authentication Failed.\r'
+
+
+def load_users(path):
+	"""Returns {ID: Password} from the database CSV (first row skipped)."""
+	with open(path, 'r', encoding='utf-8-sig') as file:
+		rows = list(csv.reader(file, delimiter=','))[1:]
+	return {int(row[0]): int(row[1]) for row in rows if row}
+
+
+def make_logins(users, count, mix, seed, slots=64):
+	"""
+	Generates the login attempts to replay.
+
+	@param: users:	{ID: Password} present on the device.
+	@param: count:	Number of attempts.
+	@param: mix:	Weights of (valid, invalid, nonexistent) attempts.
+	@param: seed:	Seed for a repeatable sequence.
+	@param: slots:	Number of User IDs on the device (USER_COUNT).
+
+	@return:		List of (kind, ID, Password).
+	"""
+	rng = random.Random(seed)
+	ids = sorted(users)
+	missing = [i for i in range(slots) if i not in users]
+	kinds = ['valid', 'invalid', 'nonexistent']
+	if not missing:
+		mix = (mix[0], mix[1], 0)
+	logins = []
+	for _ in range(count):
+		kind = rng.choices(kinds, weights=mix)[0]
+		if kind == 'nonexistent':
+			logins.append((kind, rng.choice(missing), 0))
+			continue
+		ID = rng.choice(ids)
+		PW = users[ID] if kind == 'valid' else (users[ID] + 1) % 100000000
+		logins.append((kind, ID, PW))
+	return logins
+
+
+def echo_loss(sent, echo):
+	"""Bytes of a typed line that were not echoed back by the device."""
+	return max(0, len(sent) + len(avrlink.ENDL) - len(echo))
+
+
+def login(device, kind, ID, PW):
+	"""
+	Runs one login and returns (outcome, bytes dropped). The outcome is
+	'valid', 'invalid' or 'nonexistent' as seen by the device.
+	"""
+	dropped = 0
+	device.write_line('user -l')
+	data, _ = device.expect(ID_PROMPT)
+	dropped += echo_loss('user -l', data[:-len(ID_PROMPT)])
+
+	device.write_line(str(ID))
+	data, index = device.expect(PW_PROMPT, NOT_FOUND)
+	if index == 1:
+		device.read_until(avrlink.PROMPT)
+		return 'nonexistent', dropped + echo_loss(str(ID), data[:-len(NOT_FOUND)])
+	dropped += echo_loss(str(ID), data[:-len(PW_PROMPT)])
+
+	device.write_line(str(PW))
+	data, index = device.expect(COMPLETE, FAILED)
+	dropped += echo_loss(str(PW), data[:-len((COMPLETE, FAILED)[index])])
+	device.read_until(avrlink.PROMPT)
+	return ('valid', 'invalid')[index], dropped
+
+
+def read_mem(device):
+	"""Returns the 'mem' report of the device as {name: bytes}."""
+	lines = device.command('mem')
+	return {name: int(value) for name, value in (line.split() for line in lines)}
+
+
+def scan(device, runs):
+	"""
+	Times the full listing of 'user -s' and returns the durations
+	and the number of records listed.
+	"""
+	durations = []
+	records = 0
+	for _ in range(runs):
+		begin = time.monotonic()
+		lines = device.command('user -s', admin=True)
+		durations.append(time.monotonic() - begin)
+		records = sum(1 for line in lines if line.startswith('ID: '))
+	return durations, records
+
+
+def percentile(values, p):
+	values = sorted(values)
+	return values[min(len(values)-1, int(round(p/100 * (len(values)-1))))]
+
+
+def run(device, logins, rate):
+	"""
+	Replays the logins at the given rate (logins per second, 0 for as
+	fast as possible) and returns the results.
+
+	Login n is due at start + n/rate. The device has one command line,
+	so a login can only be sent once the previous one is done, but its
+	latency is counted from the time it was due. When the device falls
+	behind, the time a login waited for the previous ones is part of
+	its latency and shows in p99 and max (no coordinated omission).
+	"""
+	latencies = []
+	dropped = 0
+	errors = 0
+	device.sync()
+	start = time.monotonic()
+	for n, (kind, ID, PW) in enumerate(logins):
+		begin = time.monotonic()
+		if rate > 0:
+			due = start + n/rate
+			if due > begin:
+				time.sleep(due - begin)
+			begin = due
+		try:
+			outcome, lost = login(device, kind, ID, PW)
+		except TimeoutError:
+			errors += 1
+			device.sync()
+			continue
+		latencies.append(time.monotonic() - begin)
+		dropped += lost
+		if outcome != kind:
+			errors += 1
+	elapsed = time.monotonic() - start
+	return {
+		'logins': len(latencies),
+		'elapsed': elapsed,
+		'latencies': latencies,
+		'dropped': dropped,
+		'errors': errors,
+	}
+
+
+def report(result):
+	latencies = result['latencies']
+	print(f'{result["logins"]} logins in {result["elapsed"]:.2f} s')
+	if latencies:
+		print(f'throughput: {result["logins"]/result["elapsed"]:.2f} logins/s')
+		print(f'latency p50: {percentile(latencies, 50)*1000:.1f} ms')
+		print(f'latency p99: {percentile(latencies, 99)*1000:.1f} ms')
+		print(f'latency max: {max(latencies)*1000:.1f} ms, mean: {statistics.mean(latencies)*1000:.1f} ms')
+	print(f'dropped bytes: {result["dropped"]}')
+	print(f'errors: {result["errors"]}')
+
+
+if __name__ == '__main__':
+
+	parser = argparse.ArgumentParser(description='Login load generator.')
+	parser.add_argument('port', help='serial port or pty of the device')
+	parser.add_argument('--baud', type=int, default=9600)
+	parser.add_argument('--csv', default='database.csv', help='database the device was loaded with')
+	parser.add_argument('--rate', type=float, default=0, help='logins per second, 0 for as fast as possible')
+	parser.add_argument('--count', type=int, default=100)
+	parser.add_argument('--mix', default='8,1,1', help='weights of valid,invalid,nonexistent logins')
+	parser.add_argument('--seed', type=int, default=1)
+	parser.add_argument('--mem', action='store_true', help='report SRAM usage before and after the run')
+	parser.add_argument('--scan', type=int, default=0, help='number of timed user -s listings')
+	parser.add_argument('--mcu', default='atmega328p', choices=sorted(database.PROFILES))
+	parser.add_argument('--audit', action='store_true', help='firmware is built with AUDIT')
+	parser.add_argument('--banks', action='store_true', help='firmware is built with DB_BANKS')
+	parser.add_argument('--wear', action='store_true', help='firmware is built with WEAR_COUNTERS')
+	parser.add_argument('--extents', action='store_true', help='firmware is built with DB_EXTENTS')
+	args = parser.parse_args()
+
+	mix = tuple(float(w) for w in args.mix.split(','))
+	slots = database.capacity(args.mcu, args.audit, args.banks, args.wear, args.extents)
+	logins = make_logins(load_users(args.csv), args.count, mix, args.seed, slots)
+	device = avrlink.Device(args.port, args.baud)
+	try:
+		if args.mem:
+			device.sync()
+			before = read_mem(device)
+		result = run(device, logins, args.rate)
+		if args.scan:
+			durations, records = scan(device, args.scan)
+		if args.mem:
+			after = read_mem(device)
+	except TimeoutError as error:
+		print(error)
+		sys.exit(1)
+	finally:
+		device.close()
+	report(result)
+	if args.scan:
+		print(f'user -s on {args.mcu}: {records} of {slots} records, '
+			f'p50 {percentile(durations, 50)*1000:.0f} ms, max {max(durations)*1000:.0f} ms')
+	if args.mem:
+		print('memory (before -> after):')
+		for name in before:
+			print(f'  {name}: {before[name]} -> {after[name]}')
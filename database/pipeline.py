@@ -0,0 +1,250 @@
+"""
+pipeline.py
+
+Pipelined client for the command line interface of the device. Where
+avrlink.Device types one command and waits for its prompt before the
+next, this client keeps sending requests while earlier ones are still
+running, so the UART stays busy instead of idling for a round trip
+between commands. The device buffers what it has not read yet in its
+receive ring (RX_SIZE in serialio.h).
+
+Every request is a command line followed by the exact lines it will
+read (admin login, answers to prompts), all sent at once. The device
+answers requests in order and ends each with its prompt, so responses
+are matched to requests first in, first out. submit() returns a
+concurrent.futures.Future (use asyncio.wrap_future from asyncio code).
+
+Flow control: the bytes of requests that have not been answered yet
+never exceed the window, by default what the receive ring holds, so
+the device never has to drop a byte.
+
+A device reset is seen as the banner the device prints at boot, or as
+no output for the timeout. The link is then reopened and brought to a
+fresh prompt, and the unanswered requests are sent again (at most 'retries' times). A request cut short by the
+reset may have run partly, so requests that must not run twice should
+be checked afterwards.
+
+Requires pyserial.
+
+"""
+
+import collections
+import concurrent.futures
+import threading
+import time
+
+import serial
+
+import avrlink
+
+
+# Receive ring of the device (RX_SIZE in serialio.h). One slot tells a
+# full ring from an empty one, so it holds RX_SIZE-1 bytes.
+RX_SIZE = 64
+RX_HOLDS = RX_SIZE - 1
+
+
+class Request:
+
+	def __init__(self, command, data, retries):
+		self.command = command
+		self.data = data
+		self.retries = retries
+		self.future = concurrent.futures.Future()
+
+
+class Client:
+	"""
+	Pipelined connection to the device. One thread writes requests as
+	the window allows and one reads and completes them.
+	"""
+
+	def __init__(self, port, baud=9600, window=RX_HOLDS, timeout=5.0, retries=1, admin=(avrlink.ADMIN_ID, avrlink.ADMIN_PW)):
+		"""
+		@param: port:		Serial port or pty path of the device.
+		@param: baud:		Baud rate (BAUD in User.h).
+		@param: window:		Most bytes of unanswered requests.
+		@param: timeout:	Seconds without output before the device is
+							taken as reset.
+		@param: retries:	Times a request is sent again after a reset.
+		@param: admin:		Admin ID and Password used for privileged commands.
+		"""
+		self.device = avrlink.Device(port, baud, timeout, admin)
+		self.window = window
+		self.timeout = timeout
+		self.retries = retries
+		self.resets = 0
+		self.stray = 0
+
+		self.lock = threading.Condition()
+		self.queue = collections.deque()
+		self.pending = collections.deque()
+		self.in_flight = 0
+		self.recovering = False
+		self.closed = False
+
+		self.device.sync()
+		self.device.serial.timeout = 0.05
+		self.writer = threading.Thread(target=self._write, daemon=True)
+		self.reader = threading.Thread(target=self._read, daemon=True)
+		self.writer.start()
+		self.reader.start()
+
+	def __enter__(self):
+		return self
+
+	def __exit__(self, *args):
+		self.close()
+
+	def close(self):
+		"""Stops both threads and fails the requests not answered yet."""
+		with self.lock:
+			self.closed = True
+			self.lock.notify_all()
+		self.writer.join()
+		self.reader.join()
+		self.device.close()
+		for request in list(self.pending) + list(self.queue):
+			request.future.set_exception(IOError(f'{self.device.name}: closed'))
+
+	def submit(self, command, admin=False, answers=()):
+		"""
+		Queues one request.
+
+		@param: command:	Command line as typed on the terminal.
+		@param: admin:		Whether the command asks for admin login.
+		@param: answers:	Lines the command reads after the login, in order.
+
+		@return:			Future of the output lines of the command, without
+							the echo of the command line.
+		"""
+		if not command.strip():
+			raise ValueError('empty command line')
+		lines = [command]
+		if admin:
+			lines += [str(self.device.admin[0]), str(self.device.admin[1])]
+		lines += [str(answer) for answer in answers]
+		data = b''.join(line.encode('ascii') + avrlink.ENDL for line in lines)
+		if len(data) > self.window:
+			raise ValueError(f'request of {len(data)} bytes does not fit the window of {self.window}')
+		request = Request(command, data, self.retries)
+		with self.lock:
+			if self.closed:
+				raise IOError(f'{self.device.name}: closed')
+			self.queue.append(request)
+			self.lock.notify_all()
+		return request.future
+
+	def command(self, command, admin=False, answers=()):
+		"""Runs one request and waits for its output lines."""
+		return self.submit(command, admin, answers).result()
+
+	def _write(self):
+		while True:
+			with self.lock:
+				while not self.closed and (self.recovering or not self.queue or self.in_flight + len(self.queue[0].data) > self.window):
+					self.lock.wait()
+				if self.closed:
+					return
+				request = self.queue.popleft()
+				self.pending.append(request)
+				self.in_flight += len(request.data)
+			try:
+				self.device.write(request.data)
+			except (serial.SerialException, OSError):
+				# The reader sees the same failure and recovers, which
+				# sends this request again.
+				time.sleep(self.device.serial.timeout)
+
+	def _read(self):
+		buffer = bytearray()
+		last = time.monotonic()
+		while not self.closed:
+			try:
+				data = self.device.serial.read(max(1, self.device.serial.in_waiting))
+			except (serial.SerialException, OSError):
+				self._recover()
+				buffer.clear()
+				last = time.monotonic()
+				continue
+			if data:
+				last = time.monotonic()
+				buffer += data
+				while avrlink.PROMPT in buffer:
+					index = buffer.index(avrlink.PROMPT)
+					chunk = bytes(buffer[:index])
+					del buffer[:index+len(avrlink.PROMPT)]
+					if not self._complete(chunk):
+						self._recover()
+						buffer.clear()
+						break
+			elif self.pending and time.monotonic() - last > self.timeout:
+				self._recover()
+				buffer.clear()
+				last = time.monotonic()
+
+	def _complete(self, chunk):
+		"""
+		Completes the oldest request with the output before a prompt.
+
+		@return:	False if the prompt shows that the device was reset.
+		"""
+		lines = [line for line in chunk.decode('ascii', 'replace').split('\r') if line]
+		with self.lock:
+			if not self.pending:
+				return True
+			if chunk.endswith(avrlink.BANNER):
+				return False
+			request = self.pending[0]
+			if not lines or lines[0] != request.command:
+				# Output of a line the device read as a command, e.g. an
+				# answer the command did not ask for.
+				self.stray += 1
+				return True
+			self.pending.popleft()
+			self.in_flight -= len(request.data)
+			self.lock.notify_all()
+		request.future.set_result(lines[1:])
+		return True
+
+	def _recover(self):
+		"""
+		Reopens the link after a reset, brings the device to a fresh
+		prompt and queues the unanswered requests again.
+		"""
+		with self.lock:
+			self.recovering = True
+		self.resets += 1
+		deadline = time.monotonic() + self.timeout
+		while not self.closed:
+			try:
+				if not self.device.serial.is_open:
+					self.device.serial.open()
+				self.device.serial.timeout = self.timeout
+				self.device.sync()
+				# Output of whatever was still in the receive ring.
+				self.device.serial.timeout = 0.2
+				while self.device.serial.read(256):
+					pass
+				break
+			except (serial.SerialException, OSError, TimeoutError):
+				self.device.serial.close()
+				if time.monotonic() > deadline:
+					break
+				time.sleep(0.5)
+		self.device.serial.timeout = 0.05
+
+		with self.lock:
+			failed = []
+			for request in reversed(self.pending):
+				request.retries -= 1
+				if request.retries < 0:
+					failed.append(request)
+				else:
+					self.queue.appendleft(request)
+			self.pending.clear()
+			self.in_flight = 0
+			self.recovering = False
+			self.lock.notify_all()
+		for request in failed:
+			request.future.set_exception(IOError(f'{self.device.name}: device reset during {request.command!r}'))
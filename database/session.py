@@ -0,0 +1,273 @@
+"""
+session.py
+
+Records the bytes exchanged with the command line of a device and
+replays them against another firmware build, comparing the output and
+the response times. A session recorded on a misbehaving field device
+can be run against any build this way, and production sessions can be
+kept as latency regression tests.
+
+A session file holds one event per line after a '#' header:
+
+	<seconds since start> <RX|TX> <bytes in hex>
+
+RX is what the device received (SIO::scanf), TX what it sent. Sessions
+are recorded either as a proxy, where the terminal is connected to a
+pty printed at start and everything is passed on to the device, or as
+a passive tap, with two serial adapters listening on the RX and TX
+lines of the device.
+
+The replay is paced by the device, not by the clock: every group of RX
+bytes is sent once the device has sent the TX bytes recorded before it
+(or the timeout passed), so the replay does not depend on the speed
+of the host or of the build. Each line sent is timed from its ENDL to
+the last byte of its output and compared with the recording. The
+device should hold the same database as when the session was recorded.
+
+With --sim the simulated device of bench.py is used instead of a port.
+
+Usage:	python session.py record SESSION (--port PORT | --tap RX_PORT TX_PORT | --sim) [--baud 9600]
+		python session.py replay SESSION (--port PORT | --sim) [--baud 9600] [--tolerance 0.2]
+
+"""
+
+import argparse
+import os
+import sys
+import threading
+import time
+import tty
+
+import serial
+
+import avrlink
+
+
+class Session:
+	"""Timestamped RX and TX bytes of one session."""
+
+	def __init__(self, baud=9600):
+		self.baud = baud
+		self.events = []
+		self.start = time.monotonic()
+		self.lock = threading.Lock()
+
+	def add(self, direction, data):
+		with self.lock:
+			self.events.append((time.monotonic() - self.start, direction, bytes(data)))
+
+	def save(self, path):
+		with open(path, 'w', newline='\n') as file:
+			file.write(f'# session baud={self.baud}\n')
+			for t, direction, data in self.events:
+				file.write(f'{t:.6f} {direction} {data.hex().upper()}\n')
+
+	@staticmethod
+	def load(path):
+		session = Session()
+		with open(path, 'r') as file:
+			for line in file:
+				line = line.strip()
+				if line.startswith('#'):
+					for field in line[1:].split():
+						if field.startswith('baud='):
+							session.baud = int(field[5:])
+					continue
+				if line:
+					t, direction, data = line.split()
+					session.events.append((float(t), direction, bytes.fromhex(data)))
+		return session
+
+	def steps(self):
+		"""
+		Splits the session into steps of (RX bytes, TX bytes that followed,
+		recorded response time). The response time is measured from the
+		last RX byte to the last TX byte of the step.
+		"""
+		steps = []
+		rx, tx = bytearray(), bytearray()
+		sent = end = 0.0
+		for t, direction, data in self.events:
+			if direction == 'RX':
+				if tx:
+					steps.append((bytes(rx), bytes(tx), end - sent))
+					rx, tx = bytearray(), bytearray()
+				rx += data
+				sent = t
+			else:
+				tx += data
+				end = t
+		if rx or tx:
+			steps.append((bytes(rx), bytes(tx), end - sent))
+		return steps
+
+
+def record_proxy(session, port):
+	"""
+	Passes bytes between a pty (for the terminal) and the device until
+	interrupted, recording both directions.
+	"""
+	device = serial.Serial(port, session.baud, timeout=0.05)
+	master, slave = os.openpty()
+	tty.setraw(slave)
+	print(f'Connect the terminal to {os.ttyname(slave)}, Ctrl+C to stop.')
+	os.set_blocking(master, False)
+	stop = threading.Event()
+
+	def to_terminal():
+		while not stop.is_set():
+			data = device.read(max(1, device.in_waiting))
+			if data:
+				session.add('TX', data)
+				os.write(master, data)
+
+	thread = threading.Thread(target=to_terminal, daemon=True)
+	thread.start()
+	try:
+		while True:
+			try:
+				data = os.read(master, 256)
+			except BlockingIOError:
+				time.sleep(0.001)
+				continue
+			session.add('RX', data)
+			device.write(data)
+	except KeyboardInterrupt:
+		pass
+	finally:
+		stop.set()
+		thread.join()
+		device.close()
+		os.close(master)
+		os.close(slave)
+
+
+def record_tap(session, rx_port, tx_port):
+	"""Listens on the RX and TX lines of the device until interrupted."""
+	ports = {'RX': serial.Serial(rx_port, session.baud, timeout=0.05), 'TX': serial.Serial(tx_port, session.baud, timeout=0.05)}
+	stop = threading.Event()
+
+	def listen(direction):
+		while not stop.is_set():
+			data = ports[direction].read(max(1, ports[direction].in_waiting))
+			if data:
+				session.add(direction, data)
+
+	threads = [threading.Thread(target=listen, args=(direction,), daemon=True) for direction in ports]
+	for thread in threads:
+		thread.start()
+	print('Listening, Ctrl+C to stop.')
+	try:
+		while True:
+			time.sleep(0.5)
+	except KeyboardInterrupt:
+		pass
+	finally:
+		stop.set()
+		for thread in threads:
+			thread.join()
+		for port in ports.values():
+			port.close()
+
+
+def replay(session, port, timeout=5.0):
+	"""
+	Replays the RX bytes of a session step by step.
+
+	@return:	List of (RX bytes, recorded TX, replayed TX, recorded
+				time, replayed time) per step.
+	"""
+	device = avrlink.Device(port, session.baud, timeout=0.01)
+	results = []
+	try:
+		# Start from a quiet line, e.g. after the prompt printed at boot.
+		quiet = time.monotonic()
+		while time.monotonic() - quiet < 0.3:
+			if device.serial.read(256):
+				quiet = time.monotonic()
+		for rx, tx, recorded in session.steps():
+			# Output before the first RX depends on the state the device
+			# was found in, it is not compared.
+			if not rx:
+				continue
+			device.write(rx)
+			sent = last = time.monotonic()
+			output = bytearray()
+			deadline = sent + timeout
+			while len(output) < len(tx) and time.monotonic() < deadline:
+				data = device.serial.read(max(1, device.serial.in_waiting))
+				if data:
+					output += data
+					last = time.monotonic()
+			results.append((rx, tx, bytes(output), recorded, last - sent))
+	finally:
+		device.close()
+	return results
+
+
+def report(results, tolerance):
+	"""
+	Prints the steps whose output differs and the lines whose response
+	time grew by more than the tolerance.
+
+	@return:	Number of differences and regressions.
+	"""
+	problems = 0
+	for index, (rx, tx, output, recorded, replayed) in enumerate(results):
+		if output != tx:
+			problems += 1
+			print(f'step {index}: sent {rx!r}')
+			print(f'  expected {tx!r}')
+			print(f'  got      {output!r}')
+	# A line may have been typed one byte per step.
+	lines = []
+	typed = bytearray()
+	for rx, _, _, recorded, replayed in results:
+		typed += rx
+		if rx.endswith(avrlink.ENDL):
+			lines.append((typed.decode('ascii', 'replace').strip(), recorded, replayed))
+			typed.clear()
+	print(f'{len(results)} steps, {len(lines)} lines, {problems} with different output.')
+	print('line                      recorded  replayed')
+	for line, recorded, replayed in lines:
+		slow = replayed > recorded * (1 + tolerance) + 0.005
+		problems += slow
+		print(f'{line[:24]:24}  {recorded*1000:6.1f} ms {replayed*1000:6.1f} ms' + ('  SLOWER' if slow else ''))
+	return problems
+
+
+if __name__ == '__main__':
+
+	parser = argparse.ArgumentParser(description='Record and replay sessions of the command line.')
+	parser.add_argument('action', choices=['record', 'replay'])
+	parser.add_argument('session', help='session file')
+	parser.add_argument('--port', help='serial port of the device')
+	parser.add_argument('--tap', nargs=2, metavar=('RX_PORT', 'TX_PORT'), help='record from two listening adapters')
+	parser.add_argument('--sim', action='store_true', help='use the simulated device of bench.py')
+	parser.add_argument('--baud', type=int, default=9600)
+	parser.add_argument('--timeout', type=float, default=5.0, help='seconds to wait for the output of a step')
+	parser.add_argument('--tolerance', type=float, default=0.2, help='allowed growth of response times')
+	args = parser.parse_args()
+
+	sim = None
+	if args.sim:
+		import bench
+		import loadgen
+		sim = bench.SimDevice(loadgen.load_users('database.csv'), args.baud)
+		args.port = sim.port
+	try:
+		if args.action == 'record':
+			session = Session(args.baud)
+			if args.tap:
+				record_tap(session, *args.tap)
+			else:
+				record_proxy(session, args.port)
+			session.save(args.session)
+			print(f'{len(session.events)} events saved to {args.session}.')
+		else:
+			results = replay(Session.load(args.session), args.port, args.timeout)
+			if report(results, args.tolerance):
+				sys.exit(1)
+	finally:
+		if sim:
+			sim.close()
@@ -0,0 +1,181 @@
+"""
+sync.py
+
+Pushes only the changed records of database.eep to a deployed device
+instead of reflashing the whole EEPROM. Should be run after database.py
+has regenerated database.eep from database.csv.
+
+The device is asked for the CRC-16 digest of every record (sync --digest).
+These are compared with the digests of the new image and only the records
+that differ are sent (sync --apply), where they are written through
+DB::Write, or deleted through DB::Delete if their status byte says so.
+The digest of the whole table is checked at the end.
+
+With --extents (firmware built with DB_EXTENTS) a record is the header
+and the Data in its extent, and is sent as a line of its own length.
+
+Usage: python sync.py PORT [--baud 9600] [--eep database.eep] [--mcu atmega328p] [--extents] [--dry-run]
+
+"""
+
+import argparse
+import sys
+
+import avrlink
+import database
+
+
+# Must match LOAD_OFFSET in User.h. The number of Users is whatever
+# the device reports digests for (USER_COUNT).
+RECORD = 16
+
+# Status byte of a deleted record (STATUS_TOMB in User.h).
+STATUS_TOMB = 0x01
+
+
+class Image(bytearray):
+	"""EEPROM contents and, with DB_EXTENTS, where the extents are."""
+	layout = None
+
+
+def load_image(path, size=1024, layout=None):
+	"""
+	Reads an Intel Hex file into a bytearray of the EEPROM contents.
+	Bytes not present in the file are left erased (0xFF).
+
+	@param: path:	Path to the .eep file generated by database.py.
+	@param: size:	Size of the EEPROM image in bytes.
+	@param: layout:	database.extent_layout() if the image has extents.
+
+	@return:		EEPROM image.
+	"""
+	image = Image(b'\xFF' * size)
+	image.layout = layout
+	with open(path, 'r') as file:
+		for line in file:
+			line = line.strip()
+			if not line.startswith(':'):
+				continue
+			raw = bytes.fromhex(line[1:])
+			length, address, rectype = raw[0], (raw[1] << 8) | raw[2], raw[3]
+			if rectype == 0x01:
+				break
+			if rectype == 0x00:
+				image[address:address+length] = raw[4:4+length]
+	return image
+
+
+def record_bytes(image, slot):
+	"""
+	Bytes of one record as covered by DB::Digest(address) and sent by
+	sync --apply: the 16 bytes of the record, or with extents the ID,
+	Password and length of the header and its status byte followed by
+	the Data. A deleted record is erased but for its status byte, so it
+	differs from an erased one.
+	"""
+	layout = getattr(image, 'layout', None)
+	if not layout:
+		record = bytes(image[slot*RECORD:slot*RECORD+RECORD])
+		if record[RECORD-1] == STATUS_TOMB:
+			return b'\xFF' * (RECORD-1) + bytes([STATUS_TOMB])
+		return record
+	header = image[slot*database.EXTENT_HEADER:(slot+1)*database.EXTENT_HEADER]
+	length, block, status = header[5], header[6], header[7]
+	if status == STATUS_TOMB:
+		return b'\xFF' * 6 + bytes([STATUS_TOMB])
+	data = b''
+	if status == 0x00 and 0 < length <= database.DATA_SIZE and block != 0xFF:
+		start = layout['base'] + block * layout['block']
+		data = image[start:start+length]
+	return bytes(header[:6] + header[7:8] + data)
+
+
+def record_digest(image, slot):
+	"""Digest of one record as calculated by DB::Digest(address)."""
+	return database.crc16(record_bytes(image, slot))
+
+
+def read_digests(device):
+	"""Returns the per-record digests and the table digest of the device."""
+	device.start('sync --digest', admin=True)
+	digests = []
+	line = device.read_line()
+	while not line.startswith('DIGEST'):
+		digests.append(int(line, 16))
+		line = device.read_line()
+	device.read_until(avrlink.PROMPT)
+	return digests, int(line.split()[1], 16)
+
+
+def changed_slots(image, digests):
+	"""Slots whose record on the device differs from the image."""
+	return [slot for slot in range(len(digests)) if record_digest(image, slot) != digests[slot]]
+
+
+def push(device, image, slots):
+	"""
+	Sends the given records to the device and returns the number of
+	records applied and the table digest reported afterwards.
+	"""
+	device.start('sync --apply', admin=True)
+	device.read_until(b'READY\r')
+	for slot in slots:
+		record = record_bytes(image, slot)
+		device.write_line(bytes([slot]).hex().upper() + record.hex().upper())
+		ack = device.serial.read(1)
+		if ack != b'+':
+			raise IOError(f'{device.name}: record {slot} rejected ({ack!r})')
+	device.write(avrlink.ENDL)
+	device.read_until(avrlink.ENDL)
+	applied = int(device.read_line().split()[1])
+	total = int(device.read_line().split()[1], 16)
+	device.read_until(avrlink.PROMPT)
+	return applied, total
+
+
+def delta_sync(device, image, dry_run=False):
+	"""
+	Brings the device up to date with the image.
+
+	@return:	List of slots that were (or would be) sent.
+	"""
+	device.sync()
+	digests, _ = read_digests(device)
+	slots = changed_slots(image, digests)
+	if slots and not dry_run:
+		applied, total = push(device, image, slots)
+		expected = database.table_digest([record_digest(image, slot) for slot in range(len(digests))])
+		if applied != len(slots) or total != expected:
+			raise IOError(f'{device.name}: digest mismatch after sync ({total:04X} != {expected:04X})')
+	return slots
+
+
+if __name__ == '__main__':
+
+	parser = argparse.ArgumentParser(description='Push changed records to a device.')
+	parser.add_argument('port', help='serial port of the device')
+	parser.add_argument('--baud', type=int, default=9600)
+	parser.add_argument('--eep', default='database.eep', help='EEPROM image generated by database.py')
+	parser.add_argument('--mcu', default='atmega328p', choices=sorted(database.PROFILES))
+	parser.add_argument('--audit', action='store_true', help='firmware is built with AUDIT')
+	parser.add_argument('--wear', action='store_true', help='firmware is built with WEAR_COUNTERS')
+	parser.add_argument('--extents', action='store_true', help='firmware is built with DB_EXTENTS')
+	parser.add_argument('--dry-run', action='store_true', help='only list the records that differ')
+	args = parser.parse_args()
+
+	layout = database.extent_layout(args.mcu, args.audit, args.wear) if args.extents else None
+	image = load_image(args.eep, database.PROFILES[args.mcu]['eeprom'], layout)
+	device = avrlink.Device(args.port, args.baud)
+	try:
+		slots = delta_sync(device, image, args.dry_run)
+	except (IOError, TimeoutError) as error:
+		print(error)
+		sys.exit(1)
+	finally:
+		device.close()
+
+	if not slots:
+		print('Device is up to date.')
+	else:
+		print(f'{len(slots)} records {"differ" if args.dry_run else "sent"}: {slots}')
+		print(f'{sum(1 + len(record_bytes(image, slot)) for slot in slots)} of {len(image)} bytes.')
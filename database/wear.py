@@ -0,0 +1,98 @@
+"""
+wear.py
+
+Reads the EEPROM write counters of a device ('wear --export', firmware
+built with WEAR_COUNTERS) and reports the regions closest to their
+endurance limit. The counters can be saved to a CSV file and compared
+with an earlier one, which shows how many writes each region took in
+between, e.g. before and after a change to the storage code.
+
+Usage: python wear.py PORT [--baud 9600] [--save wear.csv] [--compare before.csv] [--top 10]
+
+"""
+
+import argparse
+import csv
+import sys
+
+import avrlink
+
+
+# Erase/write cycles per cell guaranteed by the data sheet (WEAR_ENDURANCE in wear.h).
+ENDURANCE = 100000
+
+
+def read_wear(device):
+	"""
+	Returns the write count of every 16 byte region of the device.
+
+	@return:	Dictionary of region start address to number of writes.
+	"""
+	device.sync()
+	lines = device.command('wear --export')
+	wear = {}
+	for line in lines:
+		if line.startswith('total'):
+			break
+		address, writes = line.split(',')
+		wear[int(address, 16)] = int(writes)
+	return wear
+
+
+def save(wear, path):
+	with open(path, 'w', newline='') as file:
+		writer = csv.writer(file)
+		writer.writerow(['Address', 'Writes'])
+		for address in sorted(wear):
+			writer.writerow([f'0x{address:04X}', wear[address]])
+
+
+def load(path):
+	with open(path, 'r') as file:
+		reader = csv.reader(file)
+		next(reader)
+		return {int(row[0], 16): int(row[1]) for row in reader}
+
+
+def report(wear, top, before=None):
+	"""
+	Prints the regions with the most writes.
+
+	@param: wear:	Current counts (see read_wear).
+	@param: top:	Number of regions to print.
+	@param: before:	Earlier counts, if given the writes since then are shown too.
+	"""
+	total = sum(wear.values())
+	print(f'{total} writes in {len(wear)} regions.')
+	print('region  writes  endurance' + ('  since' if before else ''))
+	for address in sorted(wear, key=wear.get, reverse=True)[:top]:
+		line = f'0x{address:04X}  {wear[address]:6}  {wear[address]*100/ENDURANCE:8.2f}%'
+		if before:
+			line += f'  {wear[address] - before.get(address, 0):5}'
+		print(line)
+	if before:
+		print(f'{total - sum(before.values())} writes since the saved counters.')
+
+
+if __name__ == '__main__':
+
+	parser = argparse.ArgumentParser(description='Report EEPROM wear of a device.')
+	parser.add_argument('port', help='serial port of the device')
+	parser.add_argument('--baud', type=int, default=9600)
+	parser.add_argument('--save', help='write the counters to a CSV file')
+	parser.add_argument('--compare', help='CSV file saved earlier with --save')
+	parser.add_argument('--top', type=int, default=10, help='number of regions to show')
+	args = parser.parse_args()
+
+	device = avrlink.Device(args.port, args.baud)
+	try:
+		wear = read_wear(device)
+	except (ValueError, TimeoutError) as error:
+		print(error)
+		sys.exit(1)
+	finally:
+		device.close()
+
+	report(wear, args.top, load(args.compare) if args.compare else None)
+	if args.save:
+		save(wear, args.save)
@@ -14,23 +14,145 @@
 #define PW_OFFSET 1
 #define DATA_OFFSET 5 
 
+/* Values of the status byte of a record */
+#define STATUS_LIVE  0x00
+#define STATUS_TOMB  0x01
+#define STATUS_EMPTY 0xFF
+
+/* User IDs of the program memory tier (flashdb.h) are below this */
+#define FLASH_ID_LIMIT 4096
+
 /* Comment the following line if compiling for Hardware */
 #define SIMULATION
 
+/* Comment the following line to compile out the latency instrumentation (stats.h) */
+#define STATS
+
+/* Uncomment the following line to keep a login audit log in EEPROM (audit.h) */
+//#define AUDIT
+
+/* Number of User records cached in SRAM (cache.h). Comment the following line to disable the cache */
+#define CACHE_SIZE 4
+
+/* Uncomment the following line to keep two copies (banks) of the User table, so bulk updates survive a reset (eepio.h) */
+//#define DB_BANKS
+
+/* Uncomment the following line to count EEPROM writes per 16 byte region (wear.h) */
+//#define WEAR_COUNTERS
+
+/* Uncomment the following line to keep User Data of up to 40 bytes in extents of EEPROM blocks (eepio.h) */
+//#define DB_EXTENTS
+
+/* Uncomment the following line to drive the LCD over all eight data lines, ATMega1284P and ATMega2560 only (board.h) */
+//#define LCD_8BIT
+
+/* Uncomment the following line to add a PIN pad door terminal next to the UART command line (keypad.h) */
+//#define KEYPAD
+
 #ifdef SIMULATION
-	//#define F_CPU 8000000UL
-	//#define UBRR 103
-	#define F_CPU 1000000UL
-	#define UBRR 12
+	#ifndef F_CPU
+		#define F_CPU 1000000UL
+	#endif
 	#define BAUD 9600
 	#define ENDL '\r'
 #else
-	#define F_CPU 16000000UL
-	#define UBRR 16
 	#define BAUD 115200
 	#define ENDL 0x0D
 #endif
 
+#include "board.h"
+#include <string.h>
+
+#ifndef F_CPU
+	#define F_CPU BOARD_F_CPU
+#endif
+
+/* Baud rate register value for double speed operation (U2X0), rounded
+   to the nearest value. This is 12 for 9600 baud at 1 MHz and 16 for
+   115200 baud at 16 MHz. */
+#define UBRR ((F_CPU + 4UL*BAUD)/(8UL*BAUD) - 1)
+
+
+/*
+ * EEPROM layout. User records start at address 0 and take the
+ * space that is not reserved for the audit log at the end of EEPROM.
+ * Both sizes come from the board profile (board.h). On ATMega328P with
+ * AUDIT the last 128 bytes (the slots of User ID 56 to 63) hold 32 log
+ * entries of 4 bytes each, leaving 56 Users. As the ID is stored in one
+ * byte and 0xFF marks an empty record, there are at most 255 Users.
+ *
+ * With DB_BANKS the User space is split into two banks of USER_COUNT
+ * records, followed by one header record holding [generation][CRC low]
+ * [CRC high] of bank A and then of bank B. DB addresses stay those of
+ * bank A; DB::Read adds the offset of the bank being served.
+ *
+ * With WEAR_COUNTERS the write counters (two bytes per 16 byte region
+ * of EEPROM) are kept right before the audit log, 128 bytes on ATMega328P.
+ *
+ * With DB_EXTENTS a record is an 8 byte header and the Data is kept in an
+ * extent, a run of EXTENT_BLOCK byte blocks in the space after the records.
+ * The records take about a third of the User space (one per EXTENT_AVERAGE
+ * bytes of Data), 42 Users on ATMega328P, and the blocks the rest. The
+ * block number is stored in one byte, so there are at most 255 blocks.
+ * DB addresses stay ID*LOAD_OFFSET, DB::Read and DB::Write convert them.
+ */
+#define EEPROM_SIZE BOARD_EEPROM
+
+#ifdef AUDIT
+	#define AUDIT_SIZE BOARD_AUDIT
+#else
+	#define AUDIT_SIZE 0
+#endif
+
+#define AUDIT_BASE (EEPROM_SIZE-AUDIT_SIZE)
+
+#ifdef WEAR_COUNTERS
+	#define WEAR_REGIONS (EEPROM_SIZE/LOAD_OFFSET)
+	#define WEAR_SIZE (2*WEAR_REGIONS)
+#else
+	#define WEAR_SIZE 0
+#endif
+
+#define WEAR_BASE (AUDIT_BASE-WEAR_SIZE)
+
+#if defined(DB_EXTENTS) && defined(DB_BANKS)
+	#error "DB_EXTENTS can not be combined with DB_BANKS"
+#endif
+
+#ifdef DB_EXTENTS
+	#define RECORD_SIZE 8
+	#define LENGTH_OFFSET 5
+	#define EXTENT_OFFSET 6
+	#define STATUS_OFFSET 7
+	#define DATA_SIZE 40
+	#define EXTENT_AVERAGE 16
+	#define EXTENT_BLOCK (EEPROM_SIZE > 1024 ? 8 : 4)
+	#define EXTENT_NONE 0xFF
+#else
+	#define RECORD_SIZE LOAD_OFFSET
+	#define STATUS_OFFSET 15
+	#define DATA_SIZE 10
+#endif
+
+#ifdef DB_BANKS
+	#define BANK_HEADER (WEAR_BASE-LOAD_OFFSET)
+	#define BANK_HEADER_ENTRY 3
+	#define USER_SLOTS ((WEAR_BASE-LOAD_OFFSET)/(2*LOAD_OFFSET))
+#elif defined(DB_EXTENTS)
+	#define USER_SLOTS (WEAR_BASE/(RECORD_SIZE+EXTENT_AVERAGE))
+#else
+	#define USER_SLOTS (WEAR_BASE/LOAD_OFFSET)
+#endif
+
+#define USER_COUNT (USER_SLOTS > 255 ? 255 : USER_SLOTS)
+#define BANK_SIZE (USER_COUNT*LOAD_OFFSET)
+
+#ifdef DB_EXTENTS
+	#define EXTENT_BASE (USER_COUNT*RECORD_SIZE)
+	#define EXTENT_SPACE ((WEAR_BASE-EXTENT_BASE)/EXTENT_BLOCK)
+	#define EXTENT_BLOCKS (EXTENT_SPACE > 255 ? 255 : EXTENT_SPACE)
+#endif
+
 
 typedef unsigned char byte;
 
@@ -47,11 +169,11 @@ typedef unsigned char byte;
  * ID:			[0] 	byte(s)
  * Password:	[1:4] 	byte(s)
  * DATA:		[5:14]	byte(s)
- * Null Byte:	[15]	byte(s)
+ * Status:		[15]	byte(s)
  * 
  *           ____________________________________________________________________________
  * bytes:	|0 | 1    2     3    4 |  5    6    7    8   9    10   11   12   13   14 | 15|
- * data:	|ID|PW0, PW1,  PW2, PW3| DT0, DT1, DT2, DT3, DT4, DT5, DT6, DT7, DT8, DT9| /0|
+ * data:	|ID|PW0, PW1,  PW2, PW3| DT0, DT1, DT2, DT3, DT4, DT5, DT6, DT7, DT8, DT9| ST|
  *          |__|___________________|_________________________________________________|___|
  * 
  * This data is stored in little endian format.
@@ -60,13 +182,26 @@ typedef unsigned char byte;
  * 		according to User ID. And we have only 1024 bytes of EEPROM in ATMega328P. So
  * 		this means if each User data entry takes 16 bytes then we can only initialize 
  * 		User ID up to 63. So this limits the number of Users that can be implemented 
- * 		on EEPROM (64 Users only).
+ * 		on EEPROM (64 Users only). Boards with 4 KB of EEPROM hold 255 Users (board.h).
  * ->	Password was alloted four bytes because password is 8 digits long. and to 
  * 		represent 8 decimal digits 27 binary bits are needed. So we use 32 bits to
  * 		represent the password field.
  * ->	Data as per design requirement must be 10 bytes.
- * ->	An extra zero byte is added so that if user data is a string of ASCII characters
- * 		a null terminator is good to have.
+ * ->	The last byte is the status of the record. It used to be a zero byte (the null
+ * 		terminator of DATA, which is now only kept in SRAM) and a live record still has
+ * 		0x00 here. An empty record (ID 0xFF) with STATUS_TOMB is a deleted User, which
+ * 		also hides a User of the same ID in program memory (flashdb.h).
+ * ->	With DB_EXTENTS the record is a header of 8 bytes and the Data (up to DATA_SIZE
+ * 		bytes) is kept in an extent of its own, so a User takes only the space of its Data:
+ *           ________________________________________________
+ * bytes:	|0 | 1    2     3    4 |  5  |   6   |  7 |
+ * data:	|ID|PW0, PW1,  PW2, PW3| LEN | BLOCK | ST |
+ *          |__|___________________|_____|_______|____|
+ * 		DATA then holds no more than the first 10 bytes of a User made in SRAM. The Data
+ * 		of a User read from EEPROM is streamed from its extent with DB::Data.
+ * ->	Users that rarely change can be kept in program memory instead (flashdb.h).
+ * 		DB::Read looks at the EEPROM record first, so EEPROM acts as an overlay of
+ * 		overrides and deletions on top of the program memory table.
  * 
  */
 struct User
@@ -82,6 +217,12 @@ public:
 	
 	unsigned int ADDRESS;
 	
+#ifdef DB_EXTENTS
+	// Bytes of Data and first block of its extent in EEPROM (EXTENT_NONE if in DATA).
+	byte LENGTH;
+	byte EXTENT;
+#endif
+	
 	/* 
 	 * This overload of the constructor simply initializes
 	 * the object without setting any values. These vales
@@ -90,6 +231,10 @@ public:
 	User()
 	{
 		DATA[10] = 0x00;
+#ifdef DB_EXTENTS
+		LENGTH = 0;
+		EXTENT = EXTENT_NONE;
+#endif
 	}
 	
 	/* 
@@ -108,6 +253,10 @@ public:
 		}
 		DATA[10] = 0x00;
 		ADDRESS = id * (LOAD_OFFSET);
+#ifdef DB_EXTENTS
+		LENGTH = strnlen((const char*)DATA, 10);
+		EXTENT = EXTENT_NONE;
+#endif
 	}
 	
 	/*
@@ -140,4 +289,4 @@ public:
 	}
 };
 
-#endif /* COMPDIR_H_ */
\ No newline at end of file
+#endif /* COMPDIR_H_ */
\ No newline at end of file
@@ -0,0 +1,52 @@
+/*
+ * audit.h
+ *
+ * Created: 10/19/2026 11:02:37 AM
+ *  Author: Usama Mustafa
+ */ 
+
+
+#ifndef AUDIT_H_
+#define AUDIT_H_
+
+#include "User.h"
+#include "eepio.h"
+#include "serialio.h"
+#include "timer.h"
+
+#define LOG_ENTRY   5
+#define LOG_ENTRIES (AUDIT_SIZE/LOG_ENTRY)
+#define LOG_SEQ_MAX 255
+#define LOG_PASS    0x80
+#define LOG_NO_ID   0xFFFF
+
+/*
+ * Login audit log kept as a ring of 5 byte entries at AUDIT_BASE in
+ * EEPROM (User.h). The format of one entry is as follows.
+ * 
+ * SEQ:		[0]		byte(s)
+ * ID:		[1:2]	byte(s)
+ * TIME:	[3:4]	byte(s)
+ * 
+ * ID holds the whole User ID, up to FLASH_ID_LIMIT with the program
+ * memory table. An ID typed at a login that does not fit in two bytes
+ * (negative or above 65534) is kept as LOG_NO_ID.
+ * 
+ * SEQ counts from 0 to 254 and wraps, an erased entry reads 0xFF. The
+ * entries written since the last wrap of the ring continue the sequence
+ * of the first entry, so the head (the next entry to write) is the first
+ * entry that breaks the sequence. This is found with a binary search in
+ * LOG::Init, after which appends take five byte writes and no search.
+ * SEQ is written last, so an append cut short by a reset is ignored.
+ * 
+ * TIME holds the uptime in seconds (low 15 bits, wraps after 9 hours).
+ * The top bit is set when the login succeeded (LOG_PASS).
+ */
+namespace LOG
+{
+	void Init(void);
+	void Append(long ID, bool pass);
+	void Tail(int count);
+}
+
+#endif /* AUDIT_H_ */
@@ -0,0 +1,111 @@
+/*
+ * board.h
+ *
+ * Created: 10/19/2026 4:05:12 PM
+ *  Author: Usama Mustafa
+ */ 
+
+
+#ifndef BOARD_H_
+#define BOARD_H_
+
+#include <avr/io.h>
+
+/*
+ * Board profiles. Everything that depends on the target MCU is derived
+ * here from the MCU selected with -mmcu (or the Atmel Studio device),
+ * so the same code builds for every supported board without edits.
+ * 
+ * BOARD_EEPROM		EEPROM size in bytes, from E2END of the device header.
+ * BOARD_AUDIT		EEPROM bytes reserved for the audit log with AUDIT.
+ * BOARD_F_CPU		Clock of the hardware build (SIMULATION runs at 1 MHz).
+ * BOARD_UART_RX_vect	Receive complete interrupt of UART0.
+ * LCD_*		Ports of the LCD data (high nibble, or all of PORTA with
+ * 			LCD_8BIT) and control lines.
+ * KEYPAD_*		Ports and pin change interrupt of the 4x3 keypad with
+ * 			KEYPAD. The rows are bits 0-3 of KEYPAD_ROW_PORT and the
+ * 			columns 3 bits of KEYPAD_COL_PORT from KEYPAD_COL_SHIFT:
+ * 			rows PC0-PC3 and columns PB3-PB5 on ATMega328P, PC0-PC3
+ * 			and PC4-PC6 on ATMega1284P, PK0-PK3 and PK4-PK6 on
+ * 			ATMega2560 (PORTC has no pin change interrupts there).
+ * KEYPAD_JTAG		PAD::Init sets JTD in MCUCR. PC2-PC5 of ATMega1284P are
+ * 			the JTAG pins and JTAGEN is programmed by default, so the
+ * 			keypad there needs JTAG off (debug over JTAG is lost).
+ * 
+ * The UART0, EEPROM and Timer1 registers have the same names on all of
+ * these devices. On ATMega2560 UART0 is on PE0/PE1 instead of PD0/PD1,
+ * which leaves the LCD wiring on PORTD/PORTB unchanged. ATMega328P has
+ * no free 8 bit port for LCD_8BIT (PD0/PD1 are UART0).
+ * 
+ * Supported boards:
+ * 		ATMega328P	1 KB EEPROM	 64 Users
+ * 		ATMega1284P	4 KB EEPROM	255 Users
+ * 		ATMega2560	4 KB EEPROM	255 Users
+ */
+#if defined(__AVR_ATmega328P__)
+	#define BOARD_AUDIT 128
+	#define BOARD_F_CPU 16000000UL
+	#define BOARD_UART_RX_vect USART_RX_vect
+	#define KEYPAD_ROW_PORT  PORTC
+	#define KEYPAD_ROW_DDR   DDRC
+	#define KEYPAD_ROW_PIN   PINC
+	#define KEYPAD_COL_PORT  PORTB
+	#define KEYPAD_COL_DDR   DDRB
+	#define KEYPAD_COL_SHIFT 3
+	#define KEYPAD_PCMSK     PCMSK1
+	#define KEYPAD_PCIE      PCIE1
+	#define KEYPAD_PCIF      PCIF1
+	#define KEYPAD_vect      PCINT1_vect
+#elif defined(__AVR_ATmega1284P__)
+	#define BOARD_AUDIT 512
+	#define BOARD_F_CPU 16000000UL
+	#define BOARD_UART_RX_vect USART0_RX_vect
+	#define KEYPAD_ROW_PORT  PORTC
+	#define KEYPAD_ROW_DDR   DDRC
+	#define KEYPAD_ROW_PIN   PINC
+	#define KEYPAD_COL_PORT  PORTC
+	#define KEYPAD_COL_DDR   DDRC
+	#define KEYPAD_COL_SHIFT 4
+	#define KEYPAD_PCMSK     PCMSK2
+	#define KEYPAD_PCIE      PCIE2
+	#define KEYPAD_PCIF      PCIF2
+	#define KEYPAD_vect      PCINT2_vect
+	#define KEYPAD_JTAG
+#elif defined(__AVR_ATmega2560__)
+	#define BOARD_AUDIT 512
+	#define BOARD_F_CPU 16000000UL
+	#define BOARD_UART_RX_vect USART0_RX_vect
+	#define KEYPAD_ROW_PORT  PORTK
+	#define KEYPAD_ROW_DDR   DDRK
+	#define KEYPAD_ROW_PIN   PINK
+	#define KEYPAD_COL_PORT  PORTK
+	#define KEYPAD_COL_DDR   DDRK
+	#define KEYPAD_COL_SHIFT 4
+	#define KEYPAD_PCMSK     PCMSK2
+	#define KEYPAD_PCIE      PCIE2
+	#define KEYPAD_PCIF      PCIF2
+	#define KEYPAD_vect      PCINT2_vect
+#else
+	#error "Unsupported MCU, add a profile to board.h"
+#endif
+
+#define BOARD_EEPROM (E2END+1)
+
+#ifdef LCD_8BIT
+	#if defined(__AVR_ATmega328P__)
+		#error "LCD_8BIT needs a free 8 bit port, ATMega328P has none"
+	#endif
+	#define LCD_DATA_PORT PORTA
+	#define LCD_DATA_DDR  DDRA
+	#define LCD_DATA_PIN  PINA
+	#define LCD_DATA_MASK 0xFF
+#else
+	#define LCD_DATA_PORT PORTD
+	#define LCD_DATA_DDR  DDRD
+	#define LCD_DATA_PIN  PIND
+	#define LCD_DATA_MASK 0xF0
+#endif
+#define LCD_CTRL_PORT PORTB
+#define LCD_CTRL_DDR  DDRB
+
+#endif /* BOARD_H_ */
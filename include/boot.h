@@ -0,0 +1,42 @@
+/*
+ * boot.h
+ *
+ * Created: 10/19/2026 11:48:20 PM
+ *  Author: Usama Mustafa
+ */ 
+
+
+#ifndef BOOT_H_
+#define BOOT_H_
+
+#include "User.h"
+#include "timer.h"
+
+/* Boot phases, in the order they normally end. */
+#define BOOT_UART   0	/* UART::Init, the banner can be sent */
+#define BOOT_DB     1	/* DB::Init (and LOG::Init), lookups are served */
+#define BOOT_PROMPT 2	/* First prompt sent, waiting for input */
+#define BOOT_INDEX  3	/* Free-slot list and used blocks built (DB::Warm) */
+#define BOOT_LCD    4	/* LCD power-on time passed and set up (LCD::Warm) */
+#define BOOT_PHASES 5
+
+/*
+ * Boot sequence with the UART first. main() only sets up what a lookup
+ * needs before the first prompt, everything else is warmed up by
+ * BOOT::Step while waiting for input (UART::idle): one record of the
+ * free-slot list per call, and the LCD once its power-on time has
+ * passed. A command that needs either before that completes it on the
+ * spot. Once warm, Step runs DB::Scrub.
+ * 
+ * The end of every phase is kept in Timer1 ticks since TIMER::Init,
+ * the 'boot' command prints them with the time to the first prompt
+ * and to the end of the warm-up.
+ */
+namespace BOOT
+{
+	void mark(byte phase);
+	void Step(void);
+	void print(void);
+}
+
+#endif /* BOOT_H_ */
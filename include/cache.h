@@ -0,0 +1,41 @@
+/*
+ * cache.h
+ *
+ * Created: 10/19/2026 3:20:54 PM
+ *  Author: Usama Mustafa
+ */ 
+
+
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include "User.h"
+
+/*
+ * Cache of decoded User records in SRAM, filled and used by DB::Find
+ * so the badges that are used the most do not have to be read from
+ * EEPROM byte by byte on every login. Other reads (DB::Read) go to
+ * EEPROM, so a scan of the table does not evict them. Entries are replaced
+ * with the CLOCK algorithm: a hit sets the reference bit of an entry
+ * and the clock hand skips (and clears) referenced entries when looking
+ * for one to replace. DB::Write keeps cached entries up to date.
+ * 
+ * Each entry takes sizeof(User) + 3 bytes of SRAM. The number of entries
+ * is CACHE_SIZE (User.h), hits and misses are shown by the 'cache'
+ * command to size it against the SRAM budget (see 'mem').
+ */
+#ifdef CACHE_SIZE
+namespace CACHE
+{
+	bool lookup(unsigned int address, User* use);
+	void store(unsigned int address, User use);
+	void update(unsigned int address, User use);
+	void forget(unsigned int address);
+	void clear(void);
+	
+	void print(void);
+	void reset(void);
+}
+#endif
+
+#endif /* CACHE_H_ */
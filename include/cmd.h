@@ -13,6 +13,15 @@
 #include "serialio.h"
 #include "eepio.h"
 #include "lcd.h"
+#include "stats.h"
+#include "audit.h"
+#include "mem.h"
+#include "cache.h"
+#include "flashdb.h"
+#include "wear.h"
+#include "output.h"
+#include "boot.h"
+#include "keypad.h"
 
 #include <avr/pgmspace.h>
 
@@ -29,19 +38,29 @@
  */
 
 const char prompt[] PROGMEM = "cmd@avr:~$ ";
+const char banner[] PROGMEM = "\rAVR Database\r";
 
 const char help_1[] PROGMEM = "The commands are:\r";
 const char help_2[] PROGMEM = "    user    Performs operations on user database.\r";
 const char help_3[] PROGMEM = "    lcd     Grants access to LCD hardware.\r";
 const char help_4[] PROGMEM = "    clear   Clears the terminal window.\r";
+const char help_5[] PROGMEM = "    sync    Compares and updates database records from the host.\r";
+const char help_6[] PROGMEM = "    stats   Shows latency statistics, \'stats --reset\' clears them.\r";
+const char help_7[] PROGMEM = "    log     Shows the login audit log, \'log --tail N\' shows the last N entries.\r";
+const char help_8[] PROGMEM = "    mem     Shows stack and heap usage of SRAM.\r";
+const char help_9[] PROGMEM = "    cache   Shows User cache hits and misses, \'cache --reset\' clears them.\r";
+const char help_10[] PROGMEM = "    wear    Shows EEPROM writes per 16 byte region, \'wear --export\' lists all for the host.\r";
+const char help_11[] PROGMEM = "    output  Prints csv, tsv or kv records for host tools instead of text, \'output text\' goes back.\r";
+const char help_12[] PROGMEM = "    boot    Shows the time to the first prompt and to the end of the warm-up by phase.\r";
 
 const char user_1[] PROGMEM = "Usage: user [-option(s)]\r";
 const char user_2[] PROGMEM = "Performs operations on user database.\r";
 const char user_3[] PROGMEM = "The options are:\r";
 const char user_4[] PROGMEM = "    -l    --login    Authenticate the user with an ID and Password.\r";
-const char user_5[] PROGMEM = "    -a    --add      Add a user to the database. (Requires admin privileges)\r";
-const char user_6[] PROGMEM = "    -d    --delete   Delete the provided user entry from database. (Requires admin privileges)\r";
+const char user_5[] PROGMEM = "    -a    --add      Add a user to the database, with --auto at the next free ID. (Requires admin privileges)\r";
+const char user_6[] PROGMEM = "    -d    --delete   Delete the provided user entry, or a list like 3,7,10-25. (Requires admin privileges)\r";
 const char user_7[] PROGMEM = "    -s    --show     Show the entire database from EEPROM. (Requires admin privileges)\r";
+const char user_8[] PROGMEM = "    -b    --batch    Add several users, one ID,Password,Data line each. (Requires admin privileges)\r";
 
 const char lcd_1[]  PROGMEM = "Usage: lcd [-option(s)] [argument(s)]\r";
 const char lcd_2[]  PROGMEM = "Grants access to LCD hardware.\r";
@@ -52,9 +71,17 @@ const char lcd_6[]  PROGMEM = "    -l    --line     Switch the cursor to second
 const char lcd_7[]  PROGMEM = "    -b    --blink    [on/off] as argument for cursor blink.\r";
 const char lcd_8[]  PROGMEM = "    -c    --cursor   [on/off] as argument for the cursor.\r";
 
+const char sync_1[] PROGMEM = "Usage: sync [-option(s)]\r";
+const char sync_2[] PROGMEM = "Compares and updates database records from the host.\r";
+const char sync_3[] PROGMEM = "The options are:\r";
+const char sync_4[] PROGMEM = "    -g    --digest   Print the digest of every record. (Requires admin privileges)\r";
+const char sync_5[] PROGMEM = "    -a    --apply    Receive changed records from the host. (Requires admin privileges)\r";
+
 const char u_help[] PROGMEM = "Type \'user --help\' or \'user -h\' for usage details.\r";
 const char l_help[] PROGMEM = "Type \'lcd --help\' or \'lcd -h\' for usage details.\r";
 const char b_help[] PROGMEM = "Type \'lcd --blink on\' to turn on and \'lcd --blink off\' to turn off the cursor blink.\r";
+const char s_help[] PROGMEM = "Type \'sync --help\' or \'sync -h\' for usage details.\r";
+const char o_help[] PROGMEM = "Type \'output csv\', \'output tsv\', \'output kv\' or \'output text\'.\r";
 const char c_help[] PROGMEM = "Type \'lcd --cursor on\' to turn on and \'lcd --cursor off\' to turn off the lcd cursor.\r";
 
 const char err_1[]  PROGMEM = "\' is not recognized as a command.\r";
@@ -65,7 +92,7 @@ const char msc_2[]  PROGMEM = "User does not exist.\r";
 const char msc_3[]  PROGMEM = "Enter User Password: ";
 const char msc_4[]  PROGMEM = "Authentication Complete.\r";
 const char msc_5[]  PROGMEM = "Authentication Failed.\r";
-const char msc_6[]  PROGMEM = "Enter User ID between 0 and 63: ";
+const char msc_6[]  PROGMEM = "Enter User ID between 0 and ";
 const char msc_7[]  PROGMEM = "User already exits. Overwrite? (y) / (n): ";
 const char msc_8[]  PROGMEM = "Enter User Password: ";
 const char msc_9[]  PROGMEM = "Enter User Data: ";
@@ -81,13 +108,52 @@ const char msc_18[] PROGMEM = "Password: ";
 const char msc_19[] PROGMEM = "Not an admin.\r";
 const char msc_20[] PROGMEM = "Enter Admin ID: ";
 const char msc_21[] PROGMEM = "Enter Admin Password: ";
+const char msc_22[] PROGMEM = "DIGEST ";
+const char msc_23[] PROGMEM = "READY\r";
+const char msc_24[] PROGMEM = "APPLIED ";
+const char msc_25[] PROGMEM = "Not an admin.\r";
+const char msc_26[] PROGMEM = ": ";
+const char msc_27[] PROGMEM = "Not an admin.\r";
+const char msc_28[] PROGMEM = "Invalid User ID list.\r";
+const char msc_29[] PROGMEM = "Deleted: ";
+const char msc_30[] PROGMEM = ", unchanged: ";
+const char msc_31[] PROGMEM = ".\r";
+const char msc_32[] PROGMEM = "Not an admin.\r";
+const char msc_33[] PROGMEM = "Enter one User per line as ID,Password,Data. Empty line to finish.\r";
+const char msc_34[] PROGMEM = "Added: ";
+const char msc_35[] PROGMEM = ", rejected: ";
+const char msc_36[] PROGMEM = "Not an admin.\r";
+const char msc_37[] PROGMEM = "No free User ID.\r";
+const char msc_38[] PROGMEM = "User ID: ";
+const char msc_39[] PROGMEM = "Not enough EEPROM left for the User Data.\r";
+const char msc_40[] PROGMEM = "The LCD is in use by the keypad.\r";
+const char msc_41[] PROGMEM = "table";
+
+/* Field names of the records in the kv output mode (output.h). */
+const char key_id[]        PROGMEM = "id";
+const char key_pw[]        PROGMEM = "pw";
+const char key_data[]      PROGMEM = "data";
+const char key_deleted[]   PROGMEM = "deleted";
+const char key_added[]     PROGMEM = "added";
+const char key_unchanged[] PROGMEM = "unchanged";
+const char key_rejected[]  PROGMEM = "rejected";
+const char key_digest[]    PROGMEM = "digest";
+const char key_applied[]   PROGMEM = "applied";
 
 PGM_P const help_prompts[] PROGMEM =
 {
 	help_1,
 	help_2,
 	help_3,
-	help_4
+	help_4,
+	help_5,
+	help_6,
+	help_7,
+	help_8,
+	help_9,
+	help_10,
+	help_11,
+	help_12
 };
 
 PGM_P const user_prompts[] PROGMEM =
@@ -98,7 +164,8 @@ PGM_P const user_prompts[] PROGMEM =
 	user_4,
 	user_5,
 	user_6,
-	user_7
+	user_7,
+	user_8
 };
 
 PGM_P const lcd_prompts[] PROGMEM =
@@ -113,6 +180,15 @@ PGM_P const lcd_prompts[] PROGMEM =
 	lcd_8
 };
 
+PGM_P const sync_prompts[] PROGMEM =
+{
+	sync_1,
+	sync_2,
+	sync_3,
+	sync_4,
+	sync_5
+};
+
 
 /*
  * Contains a very simple command line interface to debug and
@@ -130,9 +206,29 @@ namespace CMD
 	 * user in main().
 	 */
 	void User_Login(void);
-	void User_Add(void);
+	void User_Add(bool automatic = false);
 	void User_Delete(void);
+	void User_Delete(const char*);
+	void User_Batch(void);
 	void User_Show(void);
+	void Show(User);
+	void Sync_Digest(void);
+	void Sync_Apply(void);
+	void Log_Tail(int);
+	
+	/*
+	 * Decodes a string of hexadecimal digits into the given number
+	 * of bytes. Returns false if the string is not exactly that long
+	 * or contains anything other than hexadecimal digits.
+	 */
+	bool Hex_Decode(const char*, byte*, int);
+	
+	/*
+	 * Parses a list of User IDs such as "3,7,10-25" into a bitmap with
+	 * one bit per User ID. Returns false if the list is malformed or an
+	 * ID is out of range.
+	 */
+	bool Id_List(const char*, byte*);
 	
 	void pgm_printf(const char*);
 	
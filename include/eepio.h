@@ -12,9 +12,16 @@
 #include "User.h"
 #include "serialio.h"
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include <stdlib.h>
+#include <util/crc16.h>
 
 
+/* EEPROM programming modes (EEPM1:0 in EECR) */
+#define EEP_ATOMIC 0x00
+#define EEP_ERASE  (1<<EEPM0)
+#define EEP_WRITE  (1<<EEPM1)
+
 /*
  * This namespace reads/writes directly to/from EEPROM, one byte
  * at a time.
@@ -23,6 +30,7 @@ namespace EEP
 {
 	void Write(unsigned int address, byte data);
 	byte Read(unsigned int address);
+	void Wait(void);
 }
 
 /*
@@ -32,8 +40,33 @@ namespace EEP
  */
 namespace DB
 {
-	void Write(User);
+	bool Write(User);
+	bool Write(User, const byte* data, byte length);
 	User Read(unsigned int address);
+	
+	/* Login shared by 'user -l' and the keypad, audited with AUDIT. */
+	bool Find(long ID, User*);
+	bool Login(long ID, User&, long PW);
+	
+	/* Data of a User read by DB::Read, streamed from EEPROM with DB_EXTENTS. */
+	byte Length(const User&);
+	byte Data(const User&, byte index);
+	void Stream(const User&, void (*put)(byte));
+	bool Delete(unsigned int address, bool empty = false);
+	
+	/* CRC-16 of one record and of the whole table. */
+	unsigned int Digest(unsigned int address, bool physical = false);
+	unsigned int Digest(void);
+	
+	/* Bank selection at boot, the free-slot list in the background, bulk updates (DB_BANKS in User.h). */
+	void Init(void);
+	bool Warm(void);
+	void Begin(void);
+	void Commit(void);
+	
+	/* Lowest free User ID (-1 if none) and background erase of deleted records. */
+	int Allocate(void);
+	void Scrub(void);
 }
 
-#endif /* EEPIO_H_ */
\ No newline at end of file
+#endif /* EEPIO_H_ */
\ No newline at end of file
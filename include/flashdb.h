@@ -0,0 +1,46 @@
+/*
+ * flashdb.h
+ *
+ * Created: 10/19/2026 6:12:48 PM
+ *  Author: Usama Mustafa
+ */ 
+
+
+#ifndef FLASHDB_H_
+#define FLASHDB_H_
+
+#include "User.h"
+#include <avr/pgmspace.h>
+
+/*
+ * One User in program memory. Same fields as the EEPROM record but
+ * with a two byte ID, so the table is not limited to the 255 IDs that
+ * fit in EEPROM. 16 bytes per User.
+ */
+struct FlashUser
+{
+	unsigned int ID;
+	long PW;
+	byte DATA[10];
+};
+
+/*
+ * Read-only tier of Users in program memory. The table is generated
+ * from database.csv by database.py (src/flashdb.cpp) and is sorted by
+ * ID, so a User is found with a binary search. It holds the Users that
+ * rarely change, while EEPROM keeps the ones that do. DB::Read consults
+ * EEPROM first, so an EEPROM record with the same ID overrides the table
+ * and a deleted record (STATUS_TOMB) hides it. IDs at or above USER_COUNT
+ * have no EEPROM record and can only change with a new firmware.
+ */
+extern const FlashUser flash_users[] PROGMEM;
+extern const unsigned int flash_count;
+
+namespace FLASH
+{
+	bool Read(long ID, User* use);
+	bool At(unsigned int index, User* use);
+	unsigned int Count(void);
+}
+
+#endif /* FLASHDB_H_ */
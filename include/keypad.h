@@ -0,0 +1,60 @@
+/*
+ * keypad.h
+ *
+ * Created: 10/20/2026 12:21:37 AM
+ *  Author: Usama Mustafa
+ */ 
+
+
+#ifndef KEYPAD_H_
+#define KEYPAD_H_
+
+#include "User.h"
+
+#ifdef KEYPAD
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/* Keys kept until PAD::Step gets to them, must be a power of 2. */
+#define KEYPAD_RING 8
+
+/* A press counts only if the rows were quiet this long before (ms). */
+#define KEYPAD_DEBOUNCE 20
+
+/* An entry left unfinished this many seconds is dropped. */
+#define KEYPAD_TIMEOUT 10
+
+/* Digits of an ID or PIN, further digits are ignored. */
+#define KEYPAD_DIGITS 9
+
+/*
+ * PIN pad door terminal next to the UART command line. A 4x3 keypad
+ * (board.h) is read by the pin change interrupt of its rows: the
+ * columns are held low, a press pulls a row low and the interrupt
+ * finds the column and puts the key in a ring.
+ * 
+ * PAD::Step runs the keys through the login of 'user -l': the User ID
+ * and '#', then, if the User exists, the PIN (Password) and '#'. '*'
+ * starts over. The entry is shown on the LCD, the PIN as '*', and the
+ * result is shown with DB::display or as "Denied" / "No user", and is
+ * appended to the audit log with AUDIT.
+ * 
+ * Step is called while the UART waits for input (BOOT::Step) and while
+ * it waits for the transmitter (UART::busy), so the door is served
+ * during a long listing or import too.
+ * 
+ * The LCD belongs to the door while an entry is in progress (Busy).
+ * The UART side leaves it alone then: 'user -l' does not show the User
+ * and the 'lcd' command is refused.
+ */
+namespace PAD
+{
+	void Init(void);
+	void Step(void);
+	bool Busy(void);
+}
+
+#endif
+
+#endif /* KEYPAD_H_ */
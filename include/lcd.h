@@ -14,15 +14,33 @@
 #define RW 0b010
 #define E  0b001
 
+#include "User.h"
+
 #define CLEAR        0b00000001
-#define FUNCTION_SET 0b00101000
+#ifdef LCD_8BIT
+	#define FUNCTION_SET 0b00111000
+#else
+	#define FUNCTION_SET 0b00101000
+#endif
 #define DISPLAY_ON   0b00001100
 #define ENTRY_MODE   0b00000110
+#define SET_DDRAM    0b10000000
 #define NEXTLINE     0b11000000
 
-#define DELAY 20
+/*
+ * HD44780 bus timing minimums from the data sheet in micro seconds
+ * (the Vcc 2.7 to 4.5 V column). _delay_us turns each one into CPU
+ * cycles from F_CPU, rounded up, so the bus is as fast as the LCD
+ * allows at any clock. The execution time of an instruction is not
+ * waited for, the busy flag is read before the next one instead.
+ */
+#define LCD_T_AS    0.06	/* RS and RW set-up before E rises */
+#define LCD_T_PW    0.45	/* E high, covers the data set-up time */
+#define LCD_T_CYCLE 1.0		/* E cycle */
+#define LCD_T_DDR   0.36	/* Busy flag valid after E rises */
+#define LCD_T_EXEC  37		/* Function set, before the busy flag can be read */
+#define LCD_T_POWER 40000	/* Vcc at 2.7 V to the first function set */
 
-#include "User.h"
 #include <avr/io.h>
 #include <util/delay.h>
 #include <string.h>
@@ -32,15 +50,16 @@ namespace LCD
 {
 	/* Internal functions for LCD namespace.
 	   Should not be called by user in main(). */
-	inline void _toggle_control_command(void);
-	inline void _toggle_control_display(void);
+	inline void _toggle_control(byte);
+	inline void _write(byte, byte);
 	inline void _check_bf(void);
-	inline void _clear();
 	
 	/* Set-up functions */
 	void Init(void);
+	bool Warm(void);
 	void command(byte);
 	void display(byte);
+	void position(byte row, byte column);
 
 	/* Display functions */
 	void print(const char*);
@@ -51,10 +70,11 @@ namespace LCD
 
 namespace DB
 {
-	/* Displays the provided User object from database onto LCD */
+	/* Displays the provided User object from database onto LCD.
+	   The labels are written once, later calls only rewrite the fields. */
 	void display(User);
 }
 
 
 
-#endif /* LCD_H_ */
\ No newline at end of file
+#endif /* LCD_H_ */
\ No newline at end of file
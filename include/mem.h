@@ -0,0 +1,66 @@
+/*
+ * mem.h
+ *
+ * Created: 10/19/2026 1:47:09 PM
+ *  Author: Usama Mustafa
+ */ 
+
+
+#ifndef MEM_H_
+#define MEM_H_
+
+#include "User.h"
+#include <avr/io.h>
+#include <stdlib.h>
+
+/* Value painted over the free SRAM between heap and stack at boot. */
+#define STACK_CANARY 0xC5
+
+/*
+ * SRAM usage of the firmware. The free memory between the heap and the
+ * stack is painted with STACK_CANARY before main() runs (.init3), so
+ * the deepest the stack has ever been is where the paint stops. The
+ * heap is measured by walking the free list of malloc. When the two
+ * meet the firmware resets, which the gap values show coming.
+ * 
+ * stack.now	Current stack depth in bytes.
+ * stack.peak	Deepest stack seen since boot.
+ * heap.top	Bytes between the start of the heap and its end (__brkval).
+ * heap.peak	Largest heap.top sampled since boot.
+ * heap.used	Bytes of heap.top held by allocations (with headers).
+ * heap.free	Bytes in the free list, in heap.blocks blocks.
+ * heap.largest	Largest block in the free list.
+ * gap.now	Bytes between the end of the heap and the stack pointer.
+ * gap.min	Bytes between heap.peak and stack.peak that were never
+ * 		touched by either.
+ * 
+ * The 'mem' command also prints uart.dropped, the received bytes the
+ * full receive ring has dropped since boot (UART::dropped).
+ */
+namespace MEM
+{
+	struct Info
+	{
+		unsigned int stack_now;
+		unsigned int stack_peak;
+		unsigned int heap_top;
+		unsigned int heap_peak;
+		unsigned int heap_used;
+		unsigned int heap_free;
+		unsigned int heap_blocks;
+		unsigned int heap_largest;
+		unsigned int gap_now;
+		unsigned int gap_min;
+	};
+	
+	/* Records the heap size for heap.peak. Called after every command
+	   and by the SIO functions that allocate, so the input and number
+	   buffers are counted while they are held. Other allocations are
+	   only seen if they are still held when the command ends. */
+	void sample(void);
+	
+	Info read(void);
+	void print(void);
+}
+
+#endif /* MEM_H_ */
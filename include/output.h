@@ -0,0 +1,76 @@
+/*
+ * output.h
+ *
+ * Created: 10/19/2026 11:02:47 PM
+ *  Author: Usama Mustafa
+ */
+
+
+#ifndef OUTPUT_H_
+#define OUTPUT_H_
+
+#include "User.h"
+#include <avr/pgmspace.h>
+
+/* Output modes, set with the 'output' command */
+#define OUT_TEXT 0
+#define OUT_CSV  1
+#define OUT_TSV  2
+#define OUT_KV   3
+
+/* Error codes of the status line */
+#define OUT_OK       0
+#define OUT_DENIED   1
+#define OUT_NO_USER  2
+#define OUT_INVALID  3
+#define OUT_FULL     4
+#define OUT_UNKNOWN  5
+
+/*
+ * Machine-readable output for host tools. In the text mode (default)
+ * the commands print their messages as before and nothing here prints
+ * anything. In the csv, tsv and kv modes listings are printed as one
+ * record per line with a fixed set of fields, and every command ends
+ * with a status line:
+ *
+ * 		csv		5,12345,user_00005			OK,1		ERR,denied
+ * 		tsv		5<TAB>12345<TAB>user_00005	OK<TAB>1	ERR<TAB>denied
+ * 		kv		id=5 pw=12345 data=user_00005	status=OK records=1	status=ERR error=denied
+ *
+ * The number in the status line is the count of records printed. Fields
+ * are sent to the UART as they are read, numbers digit by digit without
+ * a conversion buffer. A byte of a data field that is a control byte,
+ * not ASCII, '%' or the separator ('=' too in kv) is sent as %XX, so a
+ * line can always be split on the separator.
+ *
+ * The reports ('stats', 'mem', 'cache', 'boot', 'wear', 'log' and
+ * 'sync --digest') print one record per line of the text mode, e.g.
+ * "heap.top,312" for 'mem' or "table,48213" for the table digest of
+ * 'sync --digest'. 'sync --apply' ends with one applied,digest record. The help texts are only printed in the text
+ * mode, 'help' and the --help options answer ERR,invalid otherwise.
+ */
+namespace OUT
+{
+	bool Set(const char* name);
+	void show(void);
+	bool text(void);
+
+	/* Starts a new command, its status is OK until fail is called. */
+	void begin(void);
+	void fail(byte code);
+	void status(void);
+
+	/* One record: the fields in schema order, then end. */
+	void field(PGM_P key, long value);
+	void field(PGM_P key);
+	void put(byte c);
+	void end(void);
+	
+	/* A field holding a name from program memory, up to its first space. */
+	void name(PGM_P key, PGM_P text);
+	
+	/* A whole name,value record of a report. */
+	void pair(PGM_P text, long value);
+}
+
+#endif /* OUTPUT_H_ */
@@ -14,8 +14,15 @@
 #define CLC  0x0C
 #define TAB  0x09
 
+/* Size of the buffer returned by scanf, including the null byte */
+#define SCANF_SIZE 40
+
+/* Bytes received ahead of UART::Receive, must be a power of two */
+#define RX_SIZE 64
+
 #include "User.h"
 #include <avr/io.h>
+#include <avr/pgmspace.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -23,19 +30,36 @@
  * Low level functions to deal with UART module of 
  * ATMega328P. Most likely will not be used in main()
  * except Init method.
+ * 
+ * Received bytes are put in a ring buffer of RX_SIZE bytes by the
+ * receive interrupt, so a host can send the next commands while the
+ * current one is still running (EEPROM writes, LCD). If the ring is
+ * full the byte is dropped and counted in UART::dropped.
  */
 namespace UART
 {
 	void Init(unsigned int ubrr);
 	byte Receive(void);
 	void Send(byte data);
+	
+	extern volatile unsigned int dropped;
+	
+	/* Called over and over while Receive waits for a byte, if set. Must
+	   return quickly so no received byte is lost. */
+	extern void (*idle)(void);
+	
+	/* Called over and over while Send waits for the transmitter, if set,
+	   so long listings leave time for other work. Must not send. */
+	extern void (*busy)(void);
 }
 
 /*
  * Receives and sends a variety of data types. Note that for scanf 
  * functions data conversions must be performed later if expecting
  * user to enter an integer as the function will only return a string
- * of ASCII characters.
+ * of ASCII characters. The strings returned by scanf functions are
+ * allocated and must be freed by the caller, scanl and _scanl do the
+ * conversion to long and free the string themselves.
  */
 namespace SIO
 {
@@ -44,10 +68,15 @@ namespace SIO
 	void printf(double number);
 	void printf(int number);
 	void printf(long number);
+	void hex(byte data);
+	void pgm_printf(PGM_P line);
 	
 	const char* scanf();
 	const char* _scanf();
 	const char* scanf(const char* array);
+	long scanl(void);
+	long _scanl(void);
+	int read(char* buffer, int size);
 }
 
-#endif /* SERIALIO_H_ */
\ No newline at end of file
+#endif /* SERIALIO_H_ */
\ No newline at end of file
@@ -0,0 +1,54 @@
+/*
+ * stats.h
+ *
+ * Created: 10/19/2026 9:31:18 AM
+ *  Author: Usama Mustafa
+ */ 
+
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#include "User.h"
+#include "timer.h"
+
+/*
+ * Measurement points. Each one keeps the count, minimum, maximum
+ * and sum of its intervals (14 bytes of SRAM per point).
+ */
+#define STAT_PARSE     0	/* CMD::parse dispatch of one command */
+#define STAT_DB_READ   1	/* DB::Read of one record */
+#define STAT_DB_WRITE  2	/* DB::Write of one record */
+#define STAT_EEP_WAIT  3	/* EEP busy-wait on a previous write */
+#define STAT_UART_WAIT 4	/* UART::Send stall on a full transmit buffer */
+#define STAT_LCD_BF    5	/* LCD::_check_bf busy flag polling */
+#define STAT_LCD_CHAR  6	/* LCD::display of one character */
+#define STAT_POINTS    7
+
+/*
+ * STAT_BEGIN and STAT_END are placed around the code to be measured
+ * and are the only thing the instrumented modules use. Without STATS
+ * (User.h) they expand to nothing, so the instrumentation is compiled
+ * out entirely.
+ */
+#ifdef STATS
+	#define STAT_BEGIN(point) unsigned long _stat_##point = TIMER::ticks()
+	#define STAT_END(point)   STAT::record(point, TIMER::ticks() - _stat_##point)
+
+/*
+ * Keeps min/avg/max/count of the intervals measured at each point.
+ * Intervals are kept in Timer1 ticks and converted to micro seconds
+ * only when printed by the 'stats' command.
+ */
+namespace STAT
+{
+	void record(byte point, unsigned long ticks);
+	void reset(void);
+	void print(void);
+}
+#else
+	#define STAT_BEGIN(point)
+	#define STAT_END(point)
+#endif
+
+#endif /* STATS_H_ */
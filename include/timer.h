@@ -0,0 +1,34 @@
+/*
+ * timer.h
+ *
+ * Created: 10/19/2026 9:12:40 AM
+ *  Author: Usama Mustafa
+ */ 
+
+
+#ifndef TIMER_H_
+#define TIMER_H_
+
+#include "User.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/* Timer1 prescaler, one tick is this many CPU cycles. */
+#define TIMER_PRESCALER 8
+
+/*
+ * Free running tick counter on Timer1. The 16-bit counter is extended
+ * to 32 bits in the overflow interrupt, so with the prescaler of 8 a tick
+ * is 8 us at 1 MHz (wraps after 9.5 hours) and 0.5 us at 16 MHz (wraps
+ * after 35 minutes). Differences of two tick values are always correct
+ * as long as the interval is shorter than that.
+ */
+namespace TIMER
+{
+	void Init(void);
+	unsigned long ticks(void);
+	unsigned long uptime(void);
+	unsigned long us(unsigned long ticks);
+}
+
+#endif /* TIMER_H_ */
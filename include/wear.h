@@ -0,0 +1,44 @@
+/*
+ * wear.h
+ *
+ * Created: 10/19/2026 8:40:26 PM
+ *  Author: Usama Mustafa
+ */ 
+
+
+#ifndef WEAR_H_
+#define WEAR_H_
+
+#include "User.h"
+
+/* Writes counted in SRAM before one is added to the EEPROM counter */
+#define WEAR_BATCH 64
+
+/* Erase/write cycles per cell guaranteed by the data sheet */
+#define WEAR_ENDURANCE 100000UL
+
+/*
+ * EEPROM write counters, one per 16 byte region (LOAD_OFFSET), so the
+ * regions closest to their endurance limit can be found. EEP::Write
+ * counts every erase/write cycle it actually starts.
+ * 
+ * The counts are kept in SRAM and every WEAR_BATCH writes to a region
+ * add one to its 16 bit counter at WEAR_BASE in EEPROM (User.h). This
+ * keeps the counters at 1/64 of the wear they measure. The counters are
+ * stored inverted so that erased EEPROM reads as zero, and stop at
+ * 0xFFFF (about 4 million writes). Writes to the counters themselves
+ * are not counted. Up to WEAR_BATCH-1 writes per region are lost when
+ * the device resets, so the counts are lower bounds.
+ */
+#ifdef WEAR_COUNTERS
+namespace WEAR
+{
+	void Count(unsigned int address);
+	unsigned long Writes(unsigned int region);
+	
+	void print(void);
+	void Export(void);
+}
+#endif
+
+#endif /* WEAR_H_ */
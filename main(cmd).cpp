@@ -10,6 +10,10 @@
 #include "eepio.h"
 #include "lcd.h"
 #include "cmd.h"
+#include "timer.h"
+#include "audit.h"
+#include "boot.h"
+#include "keypad.h"
 
 #include <avr/io.h>
 #include <stdlib.h>
@@ -20,8 +24,25 @@ using namespace SIO;
 
 int main(void)
 {
-	LCD::Init();
+	/* Only what a lookup needs is set up before the first prompt, the
+	   LCD and the free-slot list are warmed up while waiting for input
+	   (boot.h). The timer comes first, it times the boot. */
+	TIMER::Init();
 	UART::Init(UBRR);
+	BOOT::mark(BOOT_UART);
+	DB::Init();
+#ifdef AUDIT
+	LOG::Init();
+#endif
+	BOOT::mark(BOOT_DB);
+	UART::idle = BOOT::Step;
+#ifdef KEYPAD
+	PAD::Init();
+	UART::busy = PAD::Step;
+#endif
+
+	/* Printed once per boot, so host tools can tell that the device was reset. */
+	CMD::pgm_printf(banner);
 
 	while(1)
 	{
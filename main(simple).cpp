@@ -10,6 +10,9 @@
 #include "eepio.h"
 #include "lcd.h"
 #include "cmd.h"
+#include "timer.h"
+#include "boot.h"
+#include "keypad.h"
 
 #include <avr/io.h>
 #include <stdlib.h>
@@ -20,14 +23,25 @@ using namespace SIO;
 
 int main(void)
 {
-	LCD::Init();
+	/* The LCD and the free-slot list are warmed up while waiting for
+	   input (boot.h). */
+	TIMER::Init();
 	UART::Init(UBRR);
+	BOOT::mark(BOOT_UART);
+	DB::Init();
+	BOOT::mark(BOOT_DB);
+	UART::idle = BOOT::Step;
+#ifdef KEYPAD
+	PAD::Init();
+	UART::busy = PAD::Step;
+#endif
 
 	while(1)
 	{
-		long ID = atol(scanf("Enter your ID: "));
+		printf("Enter your ID: ");
+		long ID = scanl();
 		printf("Enter your Password: ");
-		long PW = atol(_scanf());
+		long PW = _scanl();
 			
 		User use = DB::Read(ID*LOAD_OFFSET);
 			
@@ -35,6 +49,9 @@ int main(void)
 		{
 			printf("Authentication Complete.\r");
 			printf(use);
+#ifdef KEYPAD
+			if (!PAD::Busy())
+#endif
 			DB::display(use);
 		}
 		else
@@ -43,7 +60,7 @@ int main(void)
 			UART::Send(BELL);
 		}
 		printf("Press Enter to try again.");
-		scanf();
+		free((void*)scanf());
 		UART::Send(CLC);
 	}
 }
@@ -0,0 +1,139 @@
+/*
+ * audit.cpp
+ *
+ * Created: 10/19/2026 11:03:12 AM
+ *  Author: Usama Mustafa
+ */ 
+
+#include "audit.h"
+#include "output.h"
+
+#ifdef AUDIT
+
+/* Field names of the records in the kv output mode (output.h). */
+const char key_seq[]    PROGMEM = "seq";
+const char key_id[]     PROGMEM = "id";
+const char key_pass[]   PROGMEM = "pass";
+const char key_uptime[] PROGMEM = "uptime";
+
+/* Index of the next entry to write and its sequence number. */
+static byte head = 0;
+static byte next = 0;
+
+/* Number of valid entries in the ring. */
+static byte count = 0;
+
+static byte seq(byte index)
+{
+	return EEP::Read(AUDIT_BASE+index*LOG_ENTRY);
+}
+
+/*
+ * Finds the head of the ring. Should be called once at boot before
+ * any login is handled.
+ */
+void LOG::Init()
+{
+	byte first = seq(0);
+	if (first == 0xFF)
+	{
+		head = 0;
+		next = 0;
+		count = 0;
+		return;
+	}
+	
+	/* Entry i belongs to the current lap if its sequence number is
+	   first+i. This holds for a prefix of the ring only, so the end of
+	   that prefix is found with a binary search. */
+	byte low = 1;
+	byte high = LOG_ENTRIES;
+	while (low < high)
+	{
+		byte middle = (low + high) / 2;
+		if (seq(middle) == (first + middle) % LOG_SEQ_MAX)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	
+	next = (first + low) % LOG_SEQ_MAX;
+	count = (low < LOG_ENTRIES && seq(low) == 0xFF) ? low : LOG_ENTRIES;
+	head = low % LOG_ENTRIES;
+}
+
+/*
+ * Appends one login attempt. Costs five byte writes, of which only
+ * the last has to complete after this function returns.
+ */
+void LOG::Append(long ID, bool pass)
+{
+	unsigned int address = AUDIT_BASE+head*LOG_ENTRY;
+	unsigned int user = ((ID < 0) || (ID >= LOG_NO_ID)) ? LOG_NO_ID : ID;
+	unsigned int time = (TIMER::uptime() & 0x7FFF) | (pass ? (LOG_PASS<<8) : 0);
+	
+	EEP::Write(address+1, user);
+	EEP::Write(address+2, user>>8);
+	EEP::Write(address+3, time);
+	EEP::Write(address+4, time>>8);
+	EEP::Write(address, next);
+	
+	next = (next + 1) % LOG_SEQ_MAX;
+	head = (head + 1) % LOG_ENTRIES;
+	if (count < LOG_ENTRIES)
+	{
+		count++;
+	}
+}
+
+/*
+ * Prints the last entries of the log on the terminal, oldest first,
+ * one per line in the format "<seq> <ID> <PASS|FAIL> <uptime>", or as
+ * seq,id,pass,uptime records with pass 1 or 0 in the machine-readable
+ * modes.
+ * The keypad can append while this prints (UART::busy), so head and
+ * count are taken once and the entries printed are the ones there
+ * were when it was called.
+ */
+void LOG::Tail(int lines)
+{
+	byte last = head;
+	byte entries = count;
+	
+	if ((lines < 0) | (lines > entries))
+	{
+		lines = entries;
+	}
+	for (int i=lines; i>0; i--)
+	{
+		unsigned int address = AUDIT_BASE+((last + LOG_ENTRIES - i) % LOG_ENTRIES)*LOG_ENTRY;
+		byte number = EEP::Read(address);
+		unsigned int ID = EEP::Read(address+1) | ((unsigned int)EEP::Read(address+2)<<8);
+		byte hi = EEP::Read(address+4);
+		unsigned int time = ((unsigned int)(hi & 0x7F)<<8) | EEP::Read(address+3);
+		
+		/* The entry is read whole before printing, as an append while
+		   printing reuses the slot of the oldest entry. */
+		if (!OUT::text())
+		{
+			OUT::field(key_seq, number);
+			OUT::field(key_id, (long)ID);
+			OUT::field(key_pass, (hi & LOG_PASS) ? 1 : 0);
+			OUT::field(key_uptime, time);
+			OUT::end();
+			continue;
+		}
+		SIO::printf((int)number);
+		SIO::printf(" ");
+		SIO::printf((long)ID);
+		SIO::printf((hi & LOG_PASS) ? " PASS " : " FAIL ");
+		SIO::printf((long)time);
+		SIO::printf("\r");
+	}
+}
+
+#endif
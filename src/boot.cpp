@@ -0,0 +1,134 @@
+/*
+ * boot.cpp
+ *
+ * Created: 10/19/2026 11:49:02 PM
+ *  Author: Usama Mustafa
+ */ 
+
+#include "boot.h"
+#include "eepio.h"
+#include "lcd.h"
+#include "keypad.h"
+#include "serialio.h"
+#include "output.h"
+#include <avr/pgmspace.h>
+
+/* End of each phase in ticks, valid if its bit is set in ended. */
+static unsigned long ends[BOOT_PHASES];
+static byte ended = 0;
+
+const char boot_0[] PROGMEM = "uart     ";
+const char boot_1[] PROGMEM = "db       ";
+const char boot_2[] PROGMEM = "prompt   ";
+const char boot_3[] PROGMEM = "index    ";
+const char boot_4[] PROGMEM = "lcd      ";
+const char boot_h[] PROGMEM = "phase    end (us)\r";
+const char boot_p[] PROGMEM = "To prompt: ";
+const char boot_w[] PROGMEM = " us, to warm: ";
+
+/* Field names of the records in the kv output mode (output.h). */
+const char key_phase[] PROGMEM = "phase";
+const char key_end[]   PROGMEM = "end";
+
+PGM_P const boot_names[] PROGMEM =
+{
+	boot_0,
+	boot_1,
+	boot_2,
+	boot_3,
+	boot_4
+};
+
+static bool has_ended(byte phase)
+{
+	return ended & (1<<phase);
+}
+
+/* Marks the end of a phase. Only the first mark of each counts. */
+void BOOT::mark(byte phase)
+{
+	if (!has_ended(phase))
+	{
+		ends[phase] = TIMER::ticks();
+		ended |= (1<<phase);
+	}
+}
+
+/*
+ * The idle hook (UART::idle) from boot on. Its first call is the end
+ * of the prompt phase, as the UART is then waiting for input.
+ */
+void BOOT::Step()
+{
+	BOOT::mark(BOOT_PROMPT);
+#ifdef KEYPAD
+	PAD::Step();
+#endif
+	if (!has_ended(BOOT_INDEX) && DB::Warm())
+	{
+		BOOT::mark(BOOT_INDEX);
+	}
+	if (!has_ended(BOOT_LCD) && LCD::Warm())
+	{
+		BOOT::mark(BOOT_LCD);
+	}
+	if (has_ended(BOOT_INDEX) && has_ended(BOOT_LCD))
+	{
+		DB::Scrub();
+	}
+}
+
+/*
+ * Prints the end of every phase that has ended, then the time to the
+ * first prompt and to the end of the warm-up (the last phase). In the
+ * machine-readable modes only the phases that have ended are printed,
+ * as phase,end records. This is the output of the 'boot' command.
+ */
+void BOOT::print()
+{
+	if (!OUT::text())
+	{
+		for (byte p=0; p<BOOT_PHASES; p++)
+		{
+			if (has_ended(p))
+			{
+				OUT::name(key_phase, (PGM_P)pgm_read_word(&boot_names[p]));
+				OUT::field(key_end, TIMER::us(ends[p]));
+				OUT::end();
+			}
+		}
+		return;
+	}
+	
+	SIO::pgm_printf(boot_h);
+	unsigned long warm = 0;
+	for (byte p=0; p<BOOT_PHASES; p++)
+	{
+		SIO::pgm_printf((PGM_P)pgm_read_word(&boot_names[p]));
+		if (has_ended(p))
+		{
+			SIO::printf((long)TIMER::us(ends[p]));
+			if (ends[p] > warm)
+			{
+				warm = ends[p];
+			}
+		}
+		else
+		{
+			SIO::printf("-");
+		}
+		SIO::printf("\r");
+	}
+	SIO::pgm_printf(boot_p);
+	SIO::printf((long)TIMER::us(ends[BOOT_PROMPT]));
+	SIO::pgm_printf(boot_w);
+	if (ended == (1<<BOOT_PHASES)-1)
+	{
+		SIO::printf((long)TIMER::us(warm));
+		SIO::printf(" us\r");
+	}
+	else
+	{
+		SIO::printf("-\r");
+	}
+}
@@ -0,0 +1,167 @@
+/*
+ * cache.cpp
+ *
+ * Created: 10/19/2026 3:21:22 PM
+ *  Author: Usama Mustafa
+ */ 
+
+#include "cache.h"
+
+#ifdef CACHE_SIZE
+
+#include "serialio.h"
+#include "output.h"
+#include <avr/pgmspace.h>
+
+/* Address tag of an empty entry, no record lives there. The tags
+   are set on first use, so DB::Read works before any Init. */
+#define CACHE_EMPTY 0xFFFF
+
+struct Entry
+{
+	unsigned int address;
+	bool referenced;
+	User use;
+};
+
+static Entry entries[CACHE_SIZE];
+static byte hand = 0;
+static bool ready = false;
+
+static unsigned long hits = 0;
+static unsigned long misses = 0;
+
+static void init()
+{
+	for (int i=0; i<CACHE_SIZE; i++)
+	{
+		entries[i].address = CACHE_EMPTY;
+		entries[i].referenced = false;
+	}
+	ready = true;
+}
+
+static Entry* find(unsigned int address)
+{
+	if (!ready)
+	{
+		init();
+	}
+	for (int i=0; i<CACHE_SIZE; i++)
+	{
+		if (entries[i].address == address)
+		{
+			return &entries[i];
+		}
+	}
+	return 0;
+}
+
+/*
+ * Drops every cached User, e.g. when DB::Commit switches to the other
+ * bank. The hit and miss counters are kept.
+ */
+void CACHE::clear()
+{
+	init();
+}
+
+/*
+ * Copies the cached User at the given address into use and returns
+ * true, or returns false if it is not cached.
+ */
+bool CACHE::lookup(unsigned int address, User* use)
+{
+	Entry* entry = find(address);
+	if (entry == 0)
+	{
+		misses++;
+		return false;
+	}
+	hits++;
+	entry->referenced = true;
+	*use = entry->use;
+	return true;
+}
+
+/*
+ * Caches a User just read from EEPROM, replacing the first entry
+ * the clock hand finds without its reference bit set.
+ */
+void CACHE::store(unsigned int address, User use)
+{
+	if (find(address) != 0)
+	{
+		CACHE::update(address, use);
+		return;
+	}
+	while (entries[hand].referenced)
+	{
+		entries[hand].referenced = false;
+		hand = (hand + 1) % CACHE_SIZE;
+	}
+	entries[hand].address = address;
+	entries[hand].use = use;
+	hand = (hand + 1) % CACHE_SIZE;
+}
+
+/*
+ * Replaces the cached copy of a User that was written to EEPROM.
+ * Does nothing if the address is not cached.
+ */
+void CACHE::update(unsigned int address, User use)
+{
+	Entry* entry = find(address);
+	if (entry != 0)
+	{
+		entry->use = use;
+	}
+}
+
+/*
+ * Drops the cached copy of the User at the given address, if any.
+ */
+void CACHE::forget(unsigned int address)
+{
+	Entry* entry = find(address);
+	if (entry != 0)
+	{
+		entry->address = CACHE_EMPTY;
+		entry->referenced = false;
+	}
+}
+
+const char cache_0[] PROGMEM = "entries ";
+const char cache_1[] PROGMEM = "hits ";
+const char cache_2[] PROGMEM = "misses ";
+
+static void line(PGM_P name, unsigned long value)
+{
+	if (!OUT::text())
+	{
+		OUT::pair(name, value);
+		return;
+	}
+	SIO::pgm_printf(name);
+	SIO::printf((long)value);
+	SIO::printf("\r");
+}
+
+/*
+ * Prints the size of the cache and the hit and miss counters.
+ * This is the output of the 'cache' command.
+ */
+void CACHE::print()
+{
+	line(cache_0, CACHE_SIZE);
+	line(cache_1, hits);
+	line(cache_2, misses);
+}
+
+void CACHE::reset()
+{
+	hits = 0;
+	misses = 0;
+}
+
+#endif
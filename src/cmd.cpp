@@ -18,14 +18,23 @@
  * 		user	Performs operations on user database.
  * 		lcd	Grants access to LCD hardware.
  *  		clear	Clears the terminal window.	
+ * 		sync	Compares and updates database records from the host.
+ * 		stats	Shows latency statistics, 'stats --reset' clears them.
+ * 		log	Shows the login audit log, 'log --tail N' shows the last N entries.
+ * 		mem	Shows stack and heap usage of SRAM.
+ * 		cache	Shows User cache hits and misses, 'cache --reset' clears them.
+ * 		wear	Shows EEPROM writes per 16 byte region, 'wear --export' lists all for the host.
+ * 		output	Prints csv, tsv or kv records for host tools instead of text, 'output text' goes back.
+ * 		boot	Shows the time to the first prompt and to the end of the warm-up by phase.
  * 
  * The command 'user' has the following format.
  * Usage: user [-option(s)]
  * The options are:
  * 		-l		--login		Authenticate the user with an ID and Password.
- * 		-a		--add		Add a user to the database. (Requires admin privileges)
- * 		-d		--delete	Delete the provided user entry from database. (Requires admin privileges)
+ * 		-a		--add		Add a user to the database, with --auto at the next free ID. (Requires admin privileges)
+ * 		-d		--delete	Delete the provided user entry, or a list like 3,7,10-25. (Requires admin privileges)
  * 		-s		--show		Show the entire database from EEPROM. (Requires admin privileges)
+ * 		-b		--batch		Add several users, one ID,Password,Data line each. (Requires admin privileges)
  * 
  * The command 'lcd' has the following format.
  * Usage: lcd [-option(s)] [argument(s)]
@@ -36,11 +45,58 @@
  * 		-b		--blink		[on/off] as argument for cursor blink.
  * 		-c		--cursor	[on/off] as argument for the cursor.
  * 
+ * The command 'sync' has the following format.
+ * Usage: sync [-option(s)]
+ * The options are:
+ * 		-g		--digest	Print the digest of every record. (Requires admin privileges)
+ * 		-a		--apply		Receive changed records from the host. (Requires admin privileges)
+ * 
+ * The command 'output' has the following format.
+ * Usage: output [text/csv/tsv/kv]
+ * Without an argument the current mode is printed. In the csv, tsv and kv modes
+ * 'user -l', 'user -s', 'user -d' with a list and 'user -b' print fixed-field records
+ * instead of their messages, and every command ends with a status line (output.h).
+ * 
  * Note that the default login for Admin access is:
  * 		ID:	1234
  * 		PW:	1234
  * 
  */
+/*
+ * Prints an error message in the text mode, or records the error for the
+ * status line in the other output modes.
+ */
+static void error(const char* message, byte code)
+{
+	OUT::fail(code);
+	if (OUT::text())
+	{
+		CMD::pgm_printf(message);
+	}
+}
+
+/* Help texts are only printed in the text mode, the machine-readable
+   modes answer ERR,invalid instead (output.h). */
+static bool help()
+{
+	if (OUT::text())
+	{
+		return true;
+	}
+	OUT::fail(OUT_INVALID);
+	return false;
+}
+
+/* The LCD is left to the keypad while a door entry is in progress. */
+static bool lcd_free()
+{
+#ifdef KEYPAD
+	return !PAD::Busy();
+#else
+	return true;
+#endif
+}
+
 void CMD::parse()
 {
 	CMD::pgm_printf(prompt);
@@ -50,17 +106,41 @@ void CMD::parse()
 	char* token = strtok(argv, " ");
 	
 	/* The rest is simple conditional statements for each command. */
-	if ((strcmp(token, "exit")==0)|(strcmp(token, "")==0))
+	if ((token == NULL) || (strcmp(token, "exit")==0))
 	{
+		free(argv);
 		return;
 	}
+	
+	/* Everything from here on is measured as command dispatch. */
+	STAT_BEGIN(STAT_PARSE);
+	OUT::begin();
+	
 	if (strcmp(token, "help")==0)
 	{
-		CMD::pgm_printf(help_prompts[0]);
-		CMD::pgm_printf(help_prompts[1]);
-		CMD::pgm_printf(help_prompts[2]);
-		CMD::pgm_printf(help_prompts[3]);
-		return;
+		if (help())
+		{
+			CMD::pgm_printf(help_prompts[0]);
+			CMD::pgm_printf(help_prompts[1]);
+			CMD::pgm_printf(help_prompts[2]);
+			CMD::pgm_printf(help_prompts[3]);
+			CMD::pgm_printf(help_prompts[4]);
+#ifdef STATS
+			CMD::pgm_printf(help_prompts[5]);
+#endif
+#ifdef AUDIT
+			CMD::pgm_printf(help_prompts[6]);
+#endif
+			CMD::pgm_printf(help_prompts[7]);
+#ifdef CACHE_SIZE
+			CMD::pgm_printf(help_prompts[8]);
+#endif
+#ifdef WEAR_COUNTERS
+			CMD::pgm_printf(help_prompts[9]);
+#endif
+			CMD::pgm_printf(help_prompts[10]);
+			CMD::pgm_printf(help_prompts[11]);
+		}
 	}
 	
 	else if (strcmp(token, "user")==0)
@@ -68,13 +148,17 @@ void CMD::parse()
 		token = strtok(NULL, " ");
 		if ((strcmp(token, "--help")==0)|(strcmp(token, "-h")==0))
 		{
-			CMD::pgm_printf(user_prompts[0]);
-			CMD::pgm_printf(user_prompts[1]);
-			CMD::pgm_printf(user_prompts[2]);
-			CMD::pgm_printf(user_prompts[3]);
-			CMD::pgm_printf(user_prompts[4]);
-			CMD::pgm_printf(user_prompts[5]);
-			CMD::pgm_printf(user_prompts[6]);
+			if (help())
+			{
+				CMD::pgm_printf(user_prompts[0]);
+				CMD::pgm_printf(user_prompts[1]);
+				CMD::pgm_printf(user_prompts[2]);
+				CMD::pgm_printf(user_prompts[3]);
+				CMD::pgm_printf(user_prompts[4]);
+				CMD::pgm_printf(user_prompts[5]);
+				CMD::pgm_printf(user_prompts[6]);
+				CMD::pgm_printf(user_prompts[7]);
+			}
 		}
 		else if ((strcmp(token, "--login")==0)|(strcmp(token, "-l")==0))
 		{
@@ -82,11 +166,24 @@ void CMD::parse()
 		}
 		else if ((strcmp(token, "--add")==0)|(strcmp(token, "-a")==0))
 		{
-			CMD::User_Add();
+			token = strtok(NULL, " ");
+			CMD::User_Add((token != NULL) && (strcmp(token, "--auto")==0));
 		}
 		else if ((strcmp(token, "--delete")==0)|(strcmp(token, "-d")==0))
 		{
-			CMD::User_Delete();
+			token = strtok(NULL, " ");
+			if (token == NULL)
+			{
+				CMD::User_Delete();
+			}
+			else
+			{
+				CMD::User_Delete(token);
+			}
+		}
+		else if ((strcmp(token, "--batch")==0)|(strcmp(token, "-b")==0))
+		{
+			CMD::User_Batch();
 		}
 		else if ((strcmp(token, "--show")==0)|(strcmp(token, "-s")==0))
 		{
@@ -94,7 +191,7 @@ void CMD::parse()
 		}
 		else
 		{
-			CMD::pgm_printf(u_help);
+			error(u_help, OUT_INVALID);
 		}
 	}
 	else if(strcmp(token, "lcd")==0)
@@ -102,20 +199,25 @@ void CMD::parse()
 		token = strtok(NULL, " ");
 		if ((strcmp(token, "--help")==0)|(strcmp(token, "-h")==0))
 		{
-			CMD::pgm_printf(lcd_prompts[0]);
-			CMD::pgm_printf(lcd_prompts[1]);
-			CMD::pgm_printf(lcd_prompts[2]);
-			CMD::pgm_printf(lcd_prompts[3]);
-			CMD::pgm_printf(lcd_prompts[4]);
-			CMD::pgm_printf(lcd_prompts[5]);
-			CMD::pgm_printf(lcd_prompts[6]);
-			CMD::pgm_printf(lcd_prompts[7]);
-			
+			if (help())
+			{
+				CMD::pgm_printf(lcd_prompts[0]);
+				CMD::pgm_printf(lcd_prompts[1]);
+				CMD::pgm_printf(lcd_prompts[2]);
+				CMD::pgm_printf(lcd_prompts[3]);
+				CMD::pgm_printf(lcd_prompts[4]);
+				CMD::pgm_printf(lcd_prompts[5]);
+				CMD::pgm_printf(lcd_prompts[6]);
+				CMD::pgm_printf(lcd_prompts[7]);
+			}
+		}
+		else if (!lcd_free())
+		{
+			error(msc_40, OUT_INVALID);
 		}
 		else if ((strcmp(token, "--clear")==0)|(strcmp(token, "-s")==0))
 		{
 			LCD::command(CLEAR);
-			_delay_ms(2.5);
 		}
 		else if ((strcmp(token, "--print")==0)|(strcmp(token, "-p")==0))
 		{
@@ -139,7 +241,7 @@ void CMD::parse()
 			}
 			else
 			{
-				CMD::pgm_printf(b_help);
+				error(b_help, OUT_INVALID);
 			}
 		}
 		else if ((strcmp(token, "--cursor")==0)|(strcmp(token, "-c")==0))
@@ -155,26 +257,136 @@ void CMD::parse()
 			}
 			else
 			{
-				CMD::pgm_printf(c_help);
+				error(c_help, OUT_INVALID);
 			}
 		}
 		else
 		{
-			CMD::pgm_printf(l_help);
+			error(l_help, OUT_INVALID);
+		}
+	}
+	else if (strcmp(token, "sync")==0)
+	{
+		token = strtok(NULL, " ");
+		if ((token != NULL) && ((strcmp(token, "--help")==0)|(strcmp(token, "-h")==0)))
+		{
+			if (help())
+			{
+				CMD::pgm_printf(sync_prompts[0]);
+				CMD::pgm_printf(sync_prompts[1]);
+				CMD::pgm_printf(sync_prompts[2]);
+				CMD::pgm_printf(sync_prompts[3]);
+				CMD::pgm_printf(sync_prompts[4]);
+			}
+		}
+		else if ((token != NULL) && ((strcmp(token, "--digest")==0)|(strcmp(token, "-g")==0)))
+		{
+			CMD::Sync_Digest();
+		}
+		else if ((token != NULL) && ((strcmp(token, "--apply")==0)|(strcmp(token, "-a")==0)))
+		{
+			CMD::Sync_Apply();
+		}
+		else
+		{
+			error(s_help, OUT_INVALID);
 		}
 	}
 	else if (strcmp(token, "clear")==0)
 	{
 		UART::Send(CLC);
 	}
+#ifdef STATS
+	else if (strcmp(token, "stats")==0)
+	{
+		token = strtok(NULL, " ");
+		if ((token != NULL) && ((strcmp(token, "--reset")==0)|(strcmp(token, "-r")==0)))
+		{
+			STAT::reset();
+		}
+		else
+		{
+			STAT::print();
+		}
+	}
+#endif
+	else if (strcmp(token, "mem")==0)
+	{
+		MEM::print();
+	}
+	else if (strcmp(token, "boot")==0)
+	{
+		BOOT::print();
+	}
+#ifdef CACHE_SIZE
+	else if (strcmp(token, "cache")==0)
+	{
+		token = strtok(NULL, " ");
+		if ((token != NULL) && ((strcmp(token, "--reset")==0)|(strcmp(token, "-r")==0)))
+		{
+			CACHE::reset();
+		}
+		else
+		{
+			CACHE::print();
+		}
+	}
+#endif
+#ifdef AUDIT
+	else if (strcmp(token, "log")==0)
+	{
+		token = strtok(NULL, " ");
+		int lines = -1;
+		if ((token != NULL) && ((strcmp(token, "--tail")==0)|(strcmp(token, "-t")==0)))
+		{
+			token = strtok(NULL, " ");
+			lines = (token != NULL) ? atoi(token) : 10;
+		}
+		CMD::Log_Tail(lines);
+	}
+#endif
+#ifdef WEAR_COUNTERS
+	else if (strcmp(token, "wear")==0)
+	{
+		token = strtok(NULL, " ");
+		if ((token != NULL) && ((strcmp(token, "--export")==0)|(strcmp(token, "-e")==0)))
+		{
+			WEAR::Export();
+		}
+		else
+		{
+			WEAR::print();
+		}
+	}
+#endif
+	else if (strcmp(token, "output")==0)
+	{
+		token = strtok(NULL, " ");
+		if (token == NULL)
+		{
+			OUT::show();
+		}
+		else if (!OUT::Set(token))
+		{
+			error(o_help, OUT_INVALID);
+		}
+	}
 	else
 	{
-		SIO::printf("\'");
-		SIO::printf(token);
-		CMD::pgm_printf(err_1);
-		CMD::pgm_printf(err_2);
+		OUT::fail(OUT_UNKNOWN);
+		if (OUT::text())
+		{
+			SIO::printf("\'");
+			SIO::printf(token);
+			CMD::pgm_printf(err_1);
+			CMD::pgm_printf(err_2);
+		}
 	}
-	free(token);
+	OUT::status();
+	STAT_END(STAT_PARSE);
+	MEM::sample();
+	
+	/* The tokens point into argv, only argv itself was allocated. */
 	free(argv);	
 }
 
@@ -186,59 +398,100 @@ void CMD::parse()
 void CMD::User_Login()
 {
 	CMD::pgm_printf(msc_1);
-	long ID = atol(SIO::scanf());
-	User use = DB::Read(ID*LOAD_OFFSET);
-	
-	if ((use.ID == 0xFF) | (use.ID > 63))
+	long ID = SIO::scanl();
+	User use;
+	if (!DB::Find(ID, &use))
 	{
-		CMD::pgm_printf(msc_2);
+		error(msc_2, OUT_NO_USER);
 		return;
 	}
 	
 	CMD::pgm_printf(msc_3);
-	long PW = atol(SIO::_scanf());
+	long PW = SIO::_scanl();
 
-	if (use.authenticate(PW))
+	if (DB::Login(ID, use, PW))
 	{
-		CMD::pgm_printf(msc_4);
-		SIO::printf(use);
-		DB::display(use);
+		if (OUT::text())
+		{
+			CMD::pgm_printf(msc_4);
+			SIO::printf(use);
+		}
+		else
+		{
+			OUT::field(key_id, use.ID);
+			OUT::field(key_data);
+			DB::Stream(use, OUT::put);
+			OUT::end();
+		}
+		if (lcd_free())
+		{
+			DB::display(use);
+		}
 	}
 	else
 	{
-		CMD::pgm_printf(msc_5);
-		UART::Send(BELL);
+		error(msc_5, OUT_DENIED);
+		if (OUT::text())
+		{
+			UART::Send(BELL);
+		}
 	}
 }
 
 /* 
  * Adds the user to the database. This function requires Admin privileges because
- * this function can actually overwrite and potentially destroy data.
+ * this function can actually overwrite and potentially destroy data. With automatic
+ * set the lowest free User ID is taken from the free-slot list instead of asking.
  * 
  * The ID and Password for admin is "1234".
  */
-void CMD::User_Add()
+void CMD::User_Add(bool automatic)
 {
 	if (CMD::Admin())
 	{
-		CMD::pgm_printf(msc_6);
-		long ID = atol(SIO::scanf());
+		long ID;
+		if (automatic)
+		{
+			ID = DB::Allocate();
+			if (ID < 0)
+			{
+				error(msc_37, OUT_FULL);
+				return;
+			}
+			CMD::pgm_printf(msc_38);
+			SIO::printf(ID);
+			SIO::printf("\r");
+		}
+		else
+		{
+			CMD::pgm_printf(msc_6);
+			SIO::printf(USER_COUNT-1);
+			CMD::pgm_printf(msc_26);
+			ID = SIO::scanl();
+			if ((ID < 0) | (ID >= USER_COUNT))
+			{
+				error(msc_2, OUT_NO_USER);
+				return;
+			}
+		}
 		User check = DB::Read(ID*LOAD_OFFSET);
 		
 		if (check.ID != 0xFF)
 		{
 			CMD::pgm_printf(msc_7);
 			byte* choice = (byte*)SIO::scanf();
-			if ((strcmp((const char*)choice, "Y")==0) | (strcmp((const char*)choice, "Yes")==0) | (strcmp((const char*)choice, "y")==0) | (strcmp((const char*)choice, "yes")==0) | (strcmp((const char*)choice, "YES")==0))
+			bool overwrite = (strcmp((const char*)choice, "Y")==0) | (strcmp((const char*)choice, "Yes")==0) | (strcmp((const char*)choice, "y")==0) | (strcmp((const char*)choice, "yes")==0) | (strcmp((const char*)choice, "YES")==0);
+			free(choice);
+			if (overwrite)
 			{
 				CMD::pgm_printf(msc_8);
-				long PW = atol(SIO::_scanf());
+				long PW = SIO::_scanl();
 								
 				byte Rec = 0x00;
 				
 				CMD::pgm_printf(msc_9);
 				int i=0;
-				byte DT[10];
+				byte DT[DATA_SIZE+1];
 				do
 				{
 					Rec = (byte)UART::Receive();
@@ -251,13 +504,16 @@ void CMD::User_Add()
 					UART::Send(DT[i]);
 					i++;
 				}
-				while(i < 10);
+				while(i < DATA_SIZE);
 				
 				User use(ID, PW, DT);
 				
 				SIO::printf("\r");
 
-				DB::Write(use);				
+				if (!DB::Write(use, DT, i))
+				{
+					error(msc_39, OUT_FULL);
+				}
 				return;
 			}
 			else
@@ -268,13 +524,13 @@ void CMD::User_Add()
 		else
 		{
 			CMD::pgm_printf(msc_10);
-			long PW = atol(SIO::_scanf());
+			long PW = SIO::_scanl();
 			
 			byte Rec = 0x00;
 			
 			CMD::pgm_printf(msc_11);
 			int i=0;
-			byte DT[10];
+			byte DT[DATA_SIZE+1];
 			do
 			{
 				Rec = (byte)UART::Receive();
@@ -287,19 +543,22 @@ void CMD::User_Add()
 				UART::Send(DT[i]);
 				i++;
 			}
-			while(i < 10);
+			while(i < DATA_SIZE);
 			
 			User use(ID, PW, DT);
 			
 			SIO::printf("\r");
 
-			DB::Write(use);
+			if (!DB::Write(use, DT, i))
+			{
+				error(msc_39, OUT_FULL);
+			}
 			return;
 		}
 	}
 	else
 	{
-		CMD::pgm_printf(msc_12);
+		error(msc_12, OUT_DENIED);
 		return;
 	}
 }
@@ -316,24 +575,187 @@ void CMD::User_Delete()
 	if (CMD::Admin())
 	{
 		CMD::pgm_printf(msc_13);
-		long ID = atol(SIO::scanf());
-		User use(0xFF, 0xFFFFFFFF, (byte*)"NULL");
-		use.ADDRESS = ID*LOAD_OFFSET;
-		DB::Write(use);
+		long ID = SIO::scanl();
+		if ((ID < 0) | (ID >= USER_COUNT))
+		{
+			error(msc_2, OUT_NO_USER);
+			return;
+		}
+		if (!DB::Delete(ID*LOAD_OFFSET))
+		{
+			error(msc_2, OUT_NO_USER);
+			return;
+		}
+		
+		if (OUT::text())
+		{
+			CMD::pgm_printf(msc_14);
+			SIO::printf(ID);
+			CMD::pgm_printf(msc_15);
+		}
+	}
+	else
+	{
+		error(msc_16, OUT_DENIED);
+	}
+}
+
+/*
+ * Deletes a list of User IDs such as "3,7,10-25" in one pass over EEPROM
+ * with a single admin login. Records that are already empty are skipped
+ * without any write, and one summary is printed at the end.
+ * 
+ * The ID and Password for admin is "1234".
+ */
+void CMD::User_Delete(const char* list)
+{
+	if (CMD::Admin())
+	{
+		byte ids[(USER_COUNT+7)/8];
+		if (!CMD::Id_List(list, ids))
+		{
+			error(msc_28, OUT_INVALID);
+			return;
+		}
+		
+		int deleted = 0;
+		int unchanged = 0;
+		DB::Begin();
+		for (int i=0; i<USER_COUNT; i++)
+		{
+			if (!(ids[i/8] & (1<<(i%8))))
+			{
+				continue;
+			}
+			if (DB::Delete(i*LOAD_OFFSET))
+			{
+				deleted++;
+			}
+			else
+			{
+				unchanged++;
+			}
+		}
+		DB::Commit();
+		
+		if (OUT::text())
+		{
+			CMD::pgm_printf(msc_29);
+			SIO::printf(deleted);
+			CMD::pgm_printf(msc_30);
+			SIO::printf(unchanged);
+			CMD::pgm_printf(msc_31);
+		}
+		else
+		{
+			OUT::field(key_deleted, deleted);
+			OUT::field(key_unchanged, unchanged);
+			OUT::end();
+		}
+	}
+	else
+	{
+		error(msc_32, OUT_DENIED);
+	}
+}
+
+/*
+ * Adds several users with a single admin login. Each user is entered
+ * as one line "ID,Password,Data" and acknowledged with '+' when written,
+ * '=' when the record already holds exactly that user (nothing is
+ * written) or '!' when the line is rejected. An empty line ends the
+ * batch and one summary is printed. Lines are not echoed, which makes
+ * this suitable for pasting or for host tools.
+ * 
+ * The ID and Password for admin is "1234".
+ */
+void CMD::User_Batch()
+{
+	if (CMD::Admin())
+	{
+		CMD::pgm_printf(msc_33);
+		
+		/* ID, Password, two commas and the Data */
+		char line[16+DATA_SIZE];
+		int added = 0;
+		int unchanged = 0;
+		int rejected = 0;
+		DB::Begin();
+		while (SIO::read(line, sizeof(line)) > 0)
+		{
+			/* ID and Password must be plain numbers followed by a comma. */
+			char* pw = strchr(line, ',');
+			char* data = (pw != NULL) ? strchr(pw+1, ',') : NULL;
+			bool valid = (data != NULL) && (pw != line) && (data != pw+1);
+			for (char* c = line; valid && (c < data); c++)
+			{
+				valid = ((*c >= '0') & (*c <= '9')) | (c == pw);
+			}
+			long ID = atol(line);
+			if (!valid || (ID >= USER_COUNT))
+			{
+				UART::Send('!');
+				rejected++;
+				continue;
+			}
+			
+			byte DT[DATA_SIZE] = {0};
+			strncpy((char*)DT, data+1, DATA_SIZE);
+			byte length = strnlen(data+1, DATA_SIZE);
+			User use(ID, atol(pw+1), DT);
+			
+			User current = DB::Read(use.ADDRESS);
+			bool same = (current.ID == use.ID) && (current.get_PW() == use.get_PW()) && (DB::Length(current) == length);
+			for (byte i=0; same && (i < length); i++)
+			{
+				same = (DB::Data(current, i) == DT[i]);
+			}
+			if (same)
+			{
+				UART::Send('=');
+				unchanged++;
+				continue;
+			}
+			if (!DB::Write(use, DT, length))
+			{
+				UART::Send('!');
+				rejected++;
+				continue;
+			}
+			UART::Send('+');
+			added++;
+		}
+		DB::Commit();
 		
-		CMD::pgm_printf(msc_14);
-		SIO::printf(ID);
-		CMD::pgm_printf(msc_15);
+		SIO::printf("\r");
+		if (OUT::text())
+		{
+			CMD::pgm_printf(msc_34);
+			SIO::printf(added);
+			CMD::pgm_printf(msc_30);
+			SIO::printf(unchanged);
+			CMD::pgm_printf(msc_35);
+			SIO::printf(rejected);
+			CMD::pgm_printf(msc_31);
+		}
+		else
+		{
+			OUT::field(key_added, added);
+			OUT::field(key_unchanged, unchanged);
+			OUT::field(key_rejected, rejected);
+			OUT::end();
+		}
 	}
 	else
 	{
-		CMD::pgm_printf(msc_16);
+		error(msc_36, OUT_DENIED);
 	}
 }
 
 /*
  * This function shows all the user data in database. This function requires admin privileges
  * because this function also shows the passwords for all the users along with their data and ID.
+ * In the csv, tsv and kv output modes every User is one id,pw,data record.
  * 
  * The ID and Password for admin is "1234".
  */
@@ -341,7 +763,10 @@ void CMD::User_Show()
 {
 	if (CMD::Admin())
 	{
-		CMD::pgm_printf(msc_17);
+		if (OUT::text())
+		{
+			CMD::pgm_printf(msc_17);
+		}
 		User use;
 		int i=0;
 		do 
@@ -352,20 +777,233 @@ void CMD::User_Show()
 				i++;
 				continue;
 			}
-			SIO::printf("\r");
-			SIO::printf(use);
-			CMD::pgm_printf(msc_18);
-			SIO::printf(use.get_PW());
-			SIO::printf("\r");
+			CMD::Show(use);
 			i++;
-		} while (i<64);
+		} while (i<USER_COUNT);
+		
+		/* Users in program memory without an EEPROM record */
+		for (unsigned int j=0; j<FLASH::Count(); j++)
+		{
+			FLASH::At(j, &use);
+			if (use.ID < USER_COUNT)
+			{
+				continue;
+			}
+			CMD::Show(use);
+		}
+	}
+	else
+	{
+		error(msc_19, OUT_DENIED);
+	}
+}
+
+/*
+ * Prints one User of the listing of 'user --show', as text or as an
+ * id,pw,data record depending on the output mode.
+ */
+void CMD::Show(User use)
+{
+	if (OUT::text())
+	{
+		SIO::printf("\r");
+		SIO::printf(use);
+		CMD::pgm_printf(msc_18);
+		SIO::printf(use.get_PW());
+		SIO::printf("\r");
+	}
+	else
+	{
+		OUT::field(key_id, use.ID);
+		OUT::field(key_pw, use.get_PW());
+		OUT::field(key_data);
+		DB::Stream(use, OUT::put);
+		OUT::end();
+	}
+}
+
+/*
+ * Prints the CRC-16 digest of every record in order of User ID, one
+ * per line, followed by the digest of the whole table. The host compares
+ * these with the digests of the new EEPROM image so only the records
+ * that actually changed have to be sent (database/sync.py). In the
+ * machine-readable modes every record is an id,digest record (decimal)
+ * and the table digest is a last record with the id "table".
+ * 
+ * The ID and Password for admin is "1234".
+ */
+void CMD::Sync_Digest()
+{
+	if (CMD::Admin())
+	{
+		for (int i=0; i<USER_COUNT; i++)
+		{
+			unsigned int digest = DB::Digest(i*LOAD_OFFSET);
+			if (!OUT::text())
+			{
+				OUT::field(key_id, i);
+				OUT::field(key_digest, digest);
+				OUT::end();
+				continue;
+			}
+			SIO::hex(digest>>8);
+			SIO::hex(digest);
+			SIO::printf("\r");
+		}
+		unsigned int digest = DB::Digest();
+		if (!OUT::text())
+		{
+			OUT::name(key_id, msc_41);
+			OUT::field(key_digest, digest);
+			OUT::end();
+			return;
+		}
+		CMD::pgm_printf(msc_22);
+		SIO::hex(digest>>8);
+		SIO::hex(digest);
+		SIO::printf("\r");
 	}
 	else
 	{
-		CMD::pgm_printf(msc_19);
+		error(msc_25, OUT_DENIED);
 	}
 }
 
+/*
+ * Receives changed records from the host and writes them through
+ * DB::Write. Each record is sent as one line of 34 hexadecimal digits:
+ * the slot (User ID) in the first byte followed by the 16 record bytes
+ * exactly as they are laid out in EEPROM (User.h). A record with the
+ * STATUS_TOMB status byte is deleted (DB::Delete) instead. Every line is
+ * acknowledged with '+' when written or '!' when rejected. An empty
+ * line ends the transfer, after which the number of applied records
+ * and the digest of the whole table are printed for the final check.
+ * In the machine-readable modes there is no READY line and these two
+ * are one applied,digest record (decimal).
+ * With DB_EXTENTS a line holds the slot, the ID, Password and length
+ * bytes of the header, its status byte and then the Data, so its length
+ * varies. A record whose Data does not fit in the free blocks is
+ * rejected.
+ * With DB_BANKS the records are staged in the other bank and served
+ * only once the transfer has ended, so a reset halfway through leaves
+ * the previous table in place.
+ * 
+ * The ID and Password for admin is "1234".
+ */
+void CMD::Sync_Apply()
+{
+	if (CMD::Admin())
+	{
+		if (OUT::text())
+		{
+			CMD::pgm_printf(msc_23);
+		}
+		
+#ifdef DB_EXTENTS
+		/* Slot, ID, Password, length, status and the Data */
+		char line[2*(LENGTH_OFFSET+3+DATA_SIZE)+1];
+		byte rec[LENGTH_OFFSET+3+DATA_SIZE];
+#else
+		char line[2*(LOAD_OFFSET+1)+1];
+		byte rec[LOAD_OFFSET+1];
+#endif
+		int count = 0;
+		DB::Begin();
+		while (SIO::read(line, sizeof(line)) > 0)
+		{
+#ifdef DB_EXTENTS
+			/* The length must match the bytes that follow, an empty
+			   record (length 0xFF) has none. */
+			unsigned int size = strlen(line)/2;
+			bool valid = (size >= LENGTH_OFFSET+3) && (size <= sizeof(rec)) && CMD::Hex_Decode(line, rec, size);
+			byte length = valid ? rec[LENGTH_OFFSET+1] : 0;
+			valid = valid && (size == (unsigned int)LENGTH_OFFSET+3+((length == 0xFF) ? 0 : length));
+			byte status = valid ? rec[LENGTH_OFFSET+2] : 0;
+#else
+			bool valid = CMD::Hex_Decode(line, rec, LOAD_OFFSET+1);
+			byte status = rec[STATUS_OFFSET+1];
+#endif
+			if (!valid || (rec[0] >= USER_COUNT))
+			{
+				UART::Send('!');
+				continue;
+			}
+			
+			/* Record bytes start after the slot byte. */
+			byte* data = rec+1;
+			User use;
+			use.ADDRESS = rec[0]*LOAD_OFFSET;
+			if (status == STATUS_TOMB)
+			{
+				DB::Delete(use.ADDRESS, true);
+				UART::Send('+');
+				count++;
+				continue;
+			}
+			use.ID = data[ID_OFFSET];
+			use.set_PW((long)data[PW_OFFSET] + ((long)data[PW_OFFSET+1]<<8) + ((long)data[PW_OFFSET+2]<<16) + ((long)data[PW_OFFSET+3]<<24));
+#ifdef DB_EXTENTS
+			if (!DB::Write(use, data+LENGTH_OFFSET+2, (length == 0xFF) ? 0 : length))
+			{
+				UART::Send('!');
+				continue;
+			}
+#else
+			for (int i=0; i<10; i++)
+			{
+				use.DATA[i] = data[DATA_OFFSET+i];
+			}
+			DB::Write(use);
+#endif
+			UART::Send('+');
+			count++;
+		}
+		DB::Commit();
+		
+		SIO::printf("\r");
+		unsigned int digest = DB::Digest();
+		if (!OUT::text())
+		{
+			OUT::field(key_applied, count);
+			OUT::field(key_digest, digest);
+			OUT::end();
+			return;
+		}
+		CMD::pgm_printf(msc_24);
+		SIO::printf(count);
+		SIO::printf("\r");
+		CMD::pgm_printf(msc_22);
+		SIO::hex(digest>>8);
+		SIO::hex(digest);
+		SIO::printf("\r");
+	}
+	else
+	{
+		error(msc_25, OUT_DENIED);
+	}
+}
+
+/*
+ * Shows the last entries of the login audit log, or all of them
+ * if a negative number is given. Requires admin privileges because
+ * the log shows which User IDs were used and when.
+ * 
+ * The ID and Password for admin is "1234".
+ */
+void CMD::Log_Tail(int lines)
+{
+#ifdef AUDIT
+	if (CMD::Admin())
+	{
+		LOG::Tail(lines);
+	}
+	else
+	{
+		error(msc_27, OUT_DENIED);
+	}
+#endif
+}
+
 /*
  * Checks to see whether or not Admin privileges can be granted based
  * on and admin ID and Password.
@@ -375,9 +1013,9 @@ void CMD::User_Show()
 bool CMD::Admin()
 {
 	CMD::pgm_printf(msc_20);
-	long ID = atol(SIO::scanf());
+	long ID = SIO::scanl();
 	CMD::pgm_printf(msc_21);
-	long PW = atol(SIO::_scanf());
+	long PW = SIO::_scanl();
 	
 	if ((ID == ADMIN_ID) & (PW == ADMIN_PW))
 	{
@@ -391,8 +1029,79 @@ bool CMD::Admin()
 
 void CMD::pgm_printf(const char* entry)
 {
-	for (unsigned int i=0; i<strlen(entry); i++)
+	SIO::pgm_printf(entry);
+}
+
+bool CMD::Hex_Decode(const char* string, byte* bytes, int length)
+{
+	if (strlen(string) != (unsigned int)(2*length))
 	{
-		UART::Send(pgm_read_byte(&entry[i]));
+		return false;
+	}
+	for (int i=0; i<2*length; i++)
+	{
+		char c = string[i];
+		byte nibble;
+		if ((c >= '0') & (c <= '9'))
+		{
+			nibble = c - '0';
+		}
+		else if ((c >= 'A') & (c <= 'F'))
+		{
+			nibble = c - 'A' + 10;
+		}
+		else if ((c >= 'a') & (c <= 'f'))
+		{
+			nibble = c - 'a' + 10;
+		}
+		else
+		{
+			return false;
+		}
+		bytes[i/2] = (i%2) ? ((bytes[i/2]<<4) | nibble) : nibble;
+	}
+	return true;
+}
+
+bool CMD::Id_List(const char* list, byte* ids)
+{
+	memset(ids, 0, (USER_COUNT+7)/8);
+	const char* c = list;
+	while (true)
+	{
+		/* One ID or a range of IDs. */
+		if ((*c < '0') | (*c > '9'))
+		{
+			return false;
+		}
+		long first = strtol(c, (char**)&c, 10);
+		long last = first;
+		if (*c == '-')
+		{
+			c++;
+			if ((*c < '0') | (*c > '9'))
+			{
+				return false;
+			}
+			last = strtol(c, (char**)&c, 10);
+		}
+		if ((first > last) | (last >= USER_COUNT))
+		{
+			return false;
+		}
+		for (long i=first; i<=last; i++)
+		{
+			ids[i/8] |= (1<<(i%8));
+		}
+		
+		if (*c == '\0')
+		{
+			return true;
+		}
+		if (*c != ',')
+		{
+			return false;
+		}
+		c++;
 	}
 }
@@ -6,6 +6,11 @@
  */ 
 
 #include "eepio.h"
+#include "stats.h"
+#include "cache.h"
+#include "flashdb.h"
+#include "wear.h"
+#include "audit.h"
 
 
 
@@ -21,18 +26,54 @@
  */
 void EEP::Write(unsigned int address, byte data)
 {
+	/* Skip the erase/write cycle if the cell already holds
+	   the data. This keeps both the wear and the time of a
+	   rewrite proportional to the bytes that changed. */
+	byte old = EEP::Read(address);
+	if (old == data)
+	{
+		return;
+	}
+	
+	/* Split programming: writing 0xFF only needs the erase and
+	   clearing bits only needs the write (1.8 ms each instead of
+	   3.4 ms for the atomic erase and write). */
+	byte mode = EEP_ATOMIC;
+	if (data == 0xFF)
+	{
+		mode = EEP_ERASE;
+	}
+	else if ((old & data) == data)
+	{
+		mode = EEP_WRITE;
+	}
+
 	/* Wait for completion of previous write */
-	while(EECR & (1<<EEPE));
+	EEP::Wait();
 
 	/* Set up address and Data Registers */
 	EEAR = address;
 	EEDR = data;
 	
+	/* Programming mode, the other bits of EECR are left cleared */
+	EECR = mode;
+	
+	/* EEPE must be set within four cycles of EEMPE, so no
+	   interrupt (Timer1) may run in between. */
+	byte sreg = SREG;
+	cli();
+	
 	/* Write logical one to EEMPE */
 	EECR |= (1<<EEMPE);
 	
 	/* Start eeprom write by setting EEPE */
 	EECR |= (1<<EEPE);
+	
+	SREG = sreg;
+	
+#ifdef WEAR_COUNTERS
+	WEAR::Count(address);
+#endif
 }
 
 /* 
@@ -44,7 +85,7 @@ void EEP::Write(unsigned int address, byte data)
 byte EEP::Read(unsigned int address)
 {
 	/* Wait for completion of previous write */
-	while(EECR & (1<<EEPE));
+	EEP::Wait();
 
 	/* Set up address register */
 	EEAR = address;
@@ -56,63 +97,909 @@ byte EEP::Read(unsigned int address)
 	return EEDR;
 }
 
+/*
+ * Busy-waits for the completion of a previous write. Only
+ * waits that actually stall are measured.
+ */
+void EEP::Wait()
+{
+	if (EECR & (1<<EEPE))
+	{
+		STAT_BEGIN(STAT_EEP_WAIT);
+		while(EECR & (1<<EEPE));
+		STAT_END(STAT_EEP_WAIT);
+	}
+}
+
+#ifdef DB_BANKS
+/* Bank served by DB::Read, and whether DB::Write goes to the other
+   bank until DB::Commit (between DB::Begin and DB::Commit). */
+static byte active = 0;
+static bool staging = false;
+
+/* Records of the staged bank that hold their update or their copy from
+   the active bank, one bit per User ID, and the next byte to copy. */
+static byte staged[(USER_COUNT+7)/8];
+static unsigned int copy_at = 0;
+
+static unsigned int bank_base(byte bank)
+{
+	return bank*BANK_SIZE;
+}
+
+static unsigned int bank_digest(byte bank)
+{
+	unsigned int crc = 0xFFFF;
+	for (int i=0; i<USER_COUNT; i++)
+	{
+		unsigned int digest = DB::Digest(bank_base(bank)+i*LOAD_OFFSET, true);
+		crc = _crc16_update(crc, digest);
+		crc = _crc16_update(crc, digest>>8);
+	}
+	return crc;
+}
+
+static unsigned int bank_crc(byte bank)
+{
+	return EEP::Read(BANK_HEADER+bank*BANK_HEADER_ENTRY+1) | ((unsigned int)EEP::Read(BANK_HEADER+bank*BANK_HEADER_ENTRY+2)<<8);
+}
+
+static void bank_store(byte bank, unsigned int crc)
+{
+	EEP::Write(BANK_HEADER+bank*BANK_HEADER_ENTRY+1, crc);
+	EEP::Write(BANK_HEADER+bank*BANK_HEADER_ENTRY+2, crc>>8);
+}
+
+static void bank_seal(byte bank)
+{
+	bank_store(bank, bank_digest(bank));
+}
+
+/*
+ * Brings the CRC of a bank in line after one record changed from the
+ * digest before to its current one, without reading the other records.
+ * The CRC has no final XOR, so the change of the CRC is the CRC (from
+ * 0) of the change of the digest followed by a zero for every digest
+ * byte after it.
+ */
+static void bank_patch(byte bank, unsigned int address, unsigned int before)
+{
+	unsigned int change = before ^ DB::Digest(bank_base(bank)+address, true);
+	unsigned int crc = _crc16_update(0, change);
+	crc = _crc16_update(crc, change>>8);
+	for (int i=address/LOAD_OFFSET+1; i<USER_COUNT; i++)
+	{
+		crc = _crc16_update(crc, 0);
+		crc = _crc16_update(crc, 0);
+	}
+	bank_store(bank, bank_crc(bank) ^ crc);
+}
+
+static bool bank_valid(byte bank)
+{
+	return bank_crc(bank) == bank_digest(bank);
+}
+
+static bool is_staged(unsigned int address)
+{
+	unsigned int index = address/LOAD_OFFSET;
+	return staged[index/8] & (1<<(index%8));
+}
+
+static void set_staged(unsigned int address)
+{
+	unsigned int index = address/LOAD_OFFSET;
+	staged[index/8] |= (1<<(index%8));
+}
+
+/*
+ * Copies the next byte of the active bank that differs in the staged
+ * bank, skipping the records that are staged already. Returns false
+ * once every record is staged. With wait unset it returns at once while
+ * EEPROM is busy, and otherwise looks at one record and starts at most
+ * one write.
+ */
+static bool copy_one(bool wait)
+{
+	if (copy_at >= BANK_SIZE)
+	{
+		return false;
+	}
+	if (!wait && (EECR & (1<<EEPE)))
+	{
+		return true;
+	}
+	
+	unsigned int record = copy_at & ~(LOAD_OFFSET-1);
+	if (!is_staged(record))
+	{
+		unsigned int from = bank_base(active);
+		unsigned int to = bank_base(1-active);
+		for (unsigned int i = copy_at; i < record+LOAD_OFFSET; i++)
+		{
+			byte value = EEP::Read(from+i);
+			if (EEP::Read(to+i) != value)
+			{
+				EEP::Write(to+i, value);
+				copy_at = i + 1;
+				return true;
+			}
+		}
+		set_staged(record);
+	}
+	copy_at = record + LOAD_OFFSET;
+	return true;
+}
+
+static byte bank_generation(byte bank)
+{
+	return EEP::Read(BANK_HEADER+bank*BANK_HEADER_ENTRY);
+}
+#endif
+
+/*
+ * Physical EEPROM address of the records read by DB::Read and of the
+ * records written by DB::Write. Without DB_BANKS both are 0.
+ */
+static unsigned int read_base()
+{
+#ifdef DB_BANKS
+	return bank_base(active);
+#else
+	return 0;
+#endif
+}
+
+static unsigned int write_base()
+{
+#ifdef DB_BANKS
+	return bank_base(staging ? 1-active : active);
+#else
+	return 0;
+#endif
+}
+
+/*
+ * EEPROM address of the record of a DB address (ID*LOAD_OFFSET),
+ * relative to the bank. Records are RECORD_SIZE bytes apart.
+ */
+static unsigned int record_of(unsigned int address)
+{
+	return address/LOAD_OFFSET*RECORD_SIZE;
+}
+
+#ifdef DB_EXTENTS
+/* One bit per block of the extent space, set when the block is taken.
+   It is built from the records at boot, so it is never written to
+   EEPROM. Freeing an extent clears its bits, which merges it with the
+   free blocks around it, and DB::Write takes the first run of free
+   blocks that is long enough (first fit). */
+static byte used_blocks[(EXTENT_BLOCKS+7)/8];
+
+static byte blocks(byte length)
+{
+	return (length+EXTENT_BLOCK-1)/EXTENT_BLOCK;
+}
+
+static unsigned int extent_address(byte block)
+{
+	return EXTENT_BASE+block*EXTENT_BLOCK;
+}
+
+static void claim(byte first, byte count, bool used)
+{
+	for (unsigned int i=first; i<(unsigned int)first+count; i++)
+	{
+		if (used)
+		{
+			used_blocks[i/8] |= (1<<(i%8));
+		}
+		else
+		{
+			used_blocks[i/8] &= ~(1<<(i%8));
+		}
+	}
+}
+
+/* First block of count free blocks in a row, EXTENT_NONE if none. */
+static byte allocate(byte count)
+{
+	byte run = 0;
+	for (unsigned int i=0; i<EXTENT_BLOCKS; i++)
+	{
+		run = (used_blocks[i/8] & (1<<(i%8))) ? 0 : run+1;
+		if (run == count)
+		{
+			return i+1-count;
+		}
+	}
+	return EXTENT_NONE;
+}
+
+/*
+ * Reads the extent of a live record. Returns false if the record holds
+ * no Data (or is not live), otherwise its first block and length.
+ */
+static bool extent_of(unsigned int record, byte* first, byte* length)
+{
+	if (EEP::Read(record+STATUS_OFFSET) != STATUS_LIVE)
+	{
+		return false;
+	}
+	*length = EEP::Read(record+LENGTH_OFFSET);
+	*first = EEP::Read(record+EXTENT_OFFSET);
+	return (*length > 0) && (*length <= DATA_SIZE) && (*first != EXTENT_NONE) && ((unsigned int)*first+blocks(*length) <= EXTENT_BLOCKS);
+}
+#endif
+
+/* One bit per User ID, set when the slot is free. lowest_free is at
+   or below the lowest free ID, so DB::Allocate starts there. */
+static byte free_slots[(USER_COUNT+7)/8];
+static unsigned int lowest_free = 0;
+
+/* Deleted records whose stale bytes are still to be erased. */
+static bool scrub_pending = false;
+static bool scrub_wrote = false;
+static unsigned int scrub_at = 0;
+
+/*
+ * A slot is free when its record is deleted, or empty and not holding
+ * a User of the program memory table. Reads EEPROM only, so the cache
+ * is left alone.
+ */
+static bool slot_free(unsigned int address)
+{
+	unsigned int record = read_base()+record_of(address);
+	if (EEP::Read(record+STATUS_OFFSET) == STATUS_TOMB)
+	{
+		return true;
+	}
+	User use;
+	return (EEP::Read(record+ID_OFFSET) == 0xFF) && !FLASH::Read(address/LOAD_OFFSET, &use);
+}
+
+static void mark(unsigned int address)
+{
+	unsigned int ID = address/LOAD_OFFSET;
+	if (slot_free(address))
+	{
+		free_slots[ID/8] |= (1<<(ID%8));
+		if (ID < lowest_free)
+		{
+			lowest_free = ID;
+		}
+	}
+	else
+	{
+		free_slots[ID/8] &= ~(1<<(ID%8));
+	}
+}
+
+/* Next record to be added to the free-slot list (and with DB_EXTENTS
+   the used blocks) by DB::Warm, USER_COUNT once both are complete. */
+static unsigned int warm_at = USER_COUNT;
+
+static void warm_one()
+{
+	mark(warm_at*LOAD_OFFSET);
+#ifdef DB_EXTENTS
+	byte first, length;
+	if (extent_of(warm_at*RECORD_SIZE, &first, &length))
+	{
+		claim(first, blocks(length), true);
+	}
+#endif
+	warm_at++;
+}
+
+/*
+ * Completes the warm-up at once. Called first by everything that
+ * allocates or frees slots or blocks, DB::Read does not need it.
+ */
+static void warm()
+{
+	while (warm_at < USER_COUNT)
+	{
+		warm_one();
+	}
+}
+
+/*
+ * Starts the rebuild of the free-slot list (and with DB_EXTENTS the
+ * used blocks) from the served records, which DB::Warm then completes,
+ * and schedules the scrubbing of any deleted record.
+ */
+static void rebuild()
+{
+	lowest_free = 0;
+#ifdef DB_EXTENTS
+	memset(used_blocks, 0, sizeof(used_blocks));
+#endif
+	warm_at = 0;
+	scrub_pending = true;
+	scrub_wrote = false;
+	scrub_at = 0;
+}
+
+/*
+ * Selects the bank to serve at boot: the one with the newest generation.
+ * DB::Commit writes the generation byte last, so a bulk update cut short
+ * leaves the newer bank as it was. Its CRC can still be off, after a
+ * single DB::Write or DB::Delete (or the two CRC bytes) was cut short,
+ * or in a new image without bank headers. Falling back to the other
+ * bank would then undo the last bulk update and every write since, so
+ * the CRC of the newer bank is written again instead. The free-slot
+ * list is only started, DB::Warm builds it in the background while
+ * lookups are already served from EEPROM.
+ */
+void DB::Init()
+{
+#ifdef DB_BANKS
+	bool newer = (signed char)(bank_generation(1) - bank_generation(0)) > 0;
+	active = newer ? 1 : 0;
+	if (!bank_valid(active))
+	{
+		bank_seal(active);
+	}
+	staging = false;
+#endif
+
+	rebuild();
+}
+
+/*
+ * Starts a bulk update. Until DB::Commit every DB::Write and DB::Delete
+ * goes to the other bank, while DB::Read keeps serving the active bank.
+ * The records that are not updated are copied over from the active
+ * bank by DB::Scrub while waiting for input, a byte at a time and only
+ * the bytes that differ, and what is left when DB::Commit is called is
+ * copied then. If the device resets before DB::Commit the update is
+ * simply lost. Does nothing without DB_BANKS.
+ */
+void DB::Begin()
+{
+#ifdef DB_BANKS
+	if (staging)
+	{
+		return;
+	}
+	warm();
+	memset(staged, 0, sizeof(staged));
+	copy_at = 0;
+	staging = true;
+#endif
+}
+
+/*
+ * Ends a bulk update. The records not copied yet are copied, then the
+ * CRC of the staged bank is written and then its generation byte, which
+ * is the single write that makes it the newest valid bank. From then on
+ * it is served by DB::Read.
+ */
+void DB::Commit()
+{
+#ifdef DB_BANKS
+	if (!staging)
+	{
+		return;
+	}
+	while (copy_one(true));
+	byte bank = 1-active;
+	bank_seal(bank);
+	EEP::Write(BANK_HEADER+bank*BANK_HEADER_ENTRY, bank_generation(active)+1);
+	active = bank;
+	staging = false;
+	
+#ifdef CACHE_SIZE
+	CACHE::clear();
+#endif
+	rebuild();
+#endif
+}
+
+/*
+ * Adds one record to the free-slot list (and the used blocks), meant
+ * to be called while waiting for input. Returns true once the list is
+ * complete. Until then DB::Read is answered from EEPROM as usual and
+ * anything that allocates or frees completes the list first.
+ */
+bool DB::Warm()
+{
+	if (warm_at < USER_COUNT)
+	{
+		warm_one();
+	}
+	return warm_at >= USER_COUNT;
+}
+
+/*
+ * Returns the lowest free User ID, or -1 if every slot is taken. The
+ * list is kept up to date by DB::Write and DB::Delete, so EEPROM is
+ * not read. The search only moves past slots taken since the last call.
+ */
+int DB::Allocate()
+{
+	warm();
+	while ((lowest_free < USER_COUNT) && !(free_slots[lowest_free/8] & (1<<(lowest_free%8))))
+	{
+		lowest_free++;
+	}
+	return (lowest_free < USER_COUNT) ? (int)lowest_free : -1;
+}
+
+/*
+ * Erases one stale byte of a deleted record. Meant to be called while
+ * waiting for input (UART::idle): it returns at once while EEPROM is
+ * busy, and otherwise looks at one record and starts at most one erase,
+ * which then completes in the background. Once a whole pass over the
+ * records finds nothing to erase it does nothing until the next delete.
+ * During a bulk update (DB_BANKS) it copies the staged bank instead.
+ */
+void DB::Scrub()
+{
+#ifdef DB_BANKS
+	/* The staged bank is filled first, erasing waits for the commit. */
+	if (staging)
+	{
+		copy_one(false);
+		return;
+	}
+#endif
+	if (!scrub_pending || (EECR & (1<<EEPE)))
+	{
+		return;
+	}
+	
+	unsigned int record = read_base()+(scrub_at & ~(RECORD_SIZE-1));
+	if (EEP::Read(record+STATUS_OFFSET) == STATUS_TOMB)
+	{
+		for (unsigned int i = scrub_at%RECORD_SIZE; i < STATUS_OFFSET; i++)
+		{
+			if (EEP::Read(record+i) != 0xFF)
+			{
+				EEP::Write(record+i, 0xFF);
+				scrub_wrote = true;
+				scrub_at = (scrub_at & ~(RECORD_SIZE-1)) + i + 1;
+				return;
+			}
+		}
+	}
+	
+	/* Next record, and the end of a pass after the last one */
+	scrub_at = (scrub_at | (RECORD_SIZE-1)) + 1;
+	if (scrub_at >= USER_COUNT*RECORD_SIZE)
+	{
+		scrub_pending = scrub_wrote;
+		scrub_wrote = false;
+		scrub_at = 0;
+	}
+}
+
 /* 
  * This is a high level function which will store the given User object
  * in EEPROM in its appropriate address location with proper spaces for
- * each data types.
+ * each data types. The Data is the DATA of the object.
  */
-void DB::Write(User use)
+bool DB::Write(User use)
 {
+#ifdef DB_EXTENTS
+	return DB::Write(use, use.DATA, strnlen((const char*)use.DATA, 10));
+#else
+	return DB::Write(use, use.DATA, 10);
+#endif
+}
+
+/*
+ * Stores the User with the given Data of up to DATA_SIZE bytes, the
+ * rest of the Data field is filled with zeros. With DB_EXTENTS the Data
+ * is written to an extent first and the header last. The Data goes to
+ * a new extent, so a reset before the header is written leaves the
+ * previous User in place (the new blocks are free again at boot). Only
+ * if there is no other room the old extent is reused, which a reset can
+ * leave half written. Returns false, without writing anything, if there
+ * are not enough free blocks.
+ */
+bool DB::Write(User use, const byte* data, byte length)
+{
+	STAT_BEGIN(STAT_DB_WRITE);
+	warm();
+	
+	unsigned int address = write_base()+record_of(use.ADDRESS);
+	if (length > DATA_SIZE)
+	{
+		length = DATA_SIZE;
+	}
+#ifdef DB_BANKS
+	unsigned int before = staging ? 0 : DB::Digest(address, true);
+#endif
+	
+#ifdef DB_EXTENTS
+	if (use.ID == 0xFF)
+	{
+		length = 0;
+	}
+	
+	/* Extent of the record that is replaced */
+	byte first = EXTENT_NONE;
+	byte count = 0;
+	byte old;
+	if (extent_of(address, &first, &old))
+	{
+		count = blocks(old);
+	}
+	
+	/* The Data moves to free blocks, and is written over the old
+	   blocks only if there is no run of free blocks long enough */
+	byte need = blocks(length);
+	byte extent = EXTENT_NONE;
+	if (need > 0)
+	{
+		extent = allocate(need);
+		if ((extent == EXTENT_NONE) && (count > 0))
+		{
+			claim(first, count, false);
+			extent = allocate(need);
+			claim(first, count, true);
+		}
+		if (extent == EXTENT_NONE)
+		{
+			STAT_END(STAT_DB_WRITE);
+			return false;
+		}
+		for (byte i=0; i<length; i++)
+		{
+			EEP::Write(extent_address(extent)+i, data[i]);
+		}
+	}
+#endif
+	
 	/* ID storage */
-	EEP::Write(use.ADDRESS+ID_OFFSET, use.ID);
+	EEP::Write(address+ID_OFFSET, use.ID);
 
 	/* Password storage */
 	long PW = use.get_PW();
-	EEP::Write(use.ADDRESS+PW_OFFSET, PW);
-	EEP::Write(use.ADDRESS+PW_OFFSET+1, PW>>8);
-	EEP::Write(use.ADDRESS+PW_OFFSET+2, PW>>16);
-	EEP::Write(use.ADDRESS+PW_OFFSET+3, PW>>24);
+	EEP::Write(address+PW_OFFSET, PW);
+	EEP::Write(address+PW_OFFSET+1, PW>>8);
+	EEP::Write(address+PW_OFFSET+2, PW>>16);
+	EEP::Write(address+PW_OFFSET+3, PW>>24);
+	
+#ifdef DB_EXTENTS
+	/* Extent storage, an empty record has no length */
+	EEP::Write(address+LENGTH_OFFSET, (use.ID == 0xFF) ? 0xFF : length);
+	EEP::Write(address+EXTENT_OFFSET, extent);
 	
+	/* The old blocks are given up and the new ones taken, which is
+	   the tail of an extent that shrank or all of one that moved. */
+	claim(first, count, false);
+	claim(extent, need, true);
+	use.LENGTH = length;
+	use.EXTENT = extent;
+#else
 	/* Data storage */
 	for (int i=0; i<10; i++)
 	{
-		EEP::Write(use.ADDRESS+DATA_OFFSET+i, use.DATA[i]);
+		EEP::Write(address+DATA_OFFSET+i, (i < length) ? data[i] : 0x00);
 	}
+#endif
 	
+	/* Status storage */
+	EEP::Write(address+STATUS_OFFSET, (use.ID == 0xFF) ? STATUS_EMPTY : STATUS_LIVE);
+	
+#ifdef DB_BANKS
+	/* A staged record is not served yet, and is no longer copied from
+	   the active bank. A record written in place changes the CRC of
+	   its bank. */
+	if (staging)
+	{
+		set_staged(use.ADDRESS);
+		STAT_END(STAT_DB_WRITE);
+		return true;
+	}
+	bank_patch(active, use.ADDRESS, before);
+#endif
+	
+	mark(use.ADDRESS);
+	
+#ifdef CACHE_SIZE
+	/* Keep a cached copy in line with EEPROM. An empty record may
+	   read as a User from program memory, so it is not cached. */
+	if (use.ID == 0xFF)
+	{
+		CACHE::forget(use.ADDRESS);
+	}
+	else
+	{
+		CACHE::update(use.ADDRESS, use);
+	}
+#endif
+	
+	STAT_END(STAT_DB_WRITE);
+	return true;
 }
 
 /* 
  * This is a high level function which will read and return
  * a User object present at the given address. Note that if 
  * a User object is not present on the given address then this
- * function will give a User object with garbage values as all
- * its features. So only those Users should be accessed that 
- * are stored in data base either manually or through excel and
+ * function will give a User object with ID 0xFF and garbage values
+ * as the rest of its features. So only those Users should be accessed
+ * that are stored in data base either manually or through excel and
  * python provided alongside this code base.
+ * 
+ * The EEPROM record is looked at first. If it is empty, and not a
+ * deleted record, the User is looked up in the program memory table
+ * (flashdb.h). Addresses past the EEPROM records only exist there.
+ * A deleted record reads as an erased one, whatever stale bytes are
+ * left in it until DB::Scrub gets to them.
+ * 
+ * With DB_EXTENTS only the header is read. The Data stays in EEPROM
+ * and is read byte by byte when it is used (DB::Data, DB::Stream).
+ * The cache is left alone, so a scan of the table ('user -s') does not
+ * evict the Users that log in the most. It is filled by DB::Find.
  */ 
 User DB::Read(unsigned int address)
 {
-	/* ID read */
-	long ID = EEP::Read(address+ID_OFFSET);
+	STAT_BEGIN(STAT_DB_READ);
 	
-	/* Password read */
-	long PW0 = EEP::Read(address+PW_OFFSET);
-	long PW1 = EEP::Read(address+PW_OFFSET+1);
-	long PW2 = EEP::Read(address+PW_OFFSET+2);
-	long PW3 = EEP::Read(address+PW_OFFSET+3);
-	long PW = PW0+(PW1<<8)+(PW2<<16)+(PW3<<24);
-
 	/* User object initialization for return value */
 	User use;
-	use.ID = ID;
-	use.set_PW(PW);
 	
-	/* Data read */
-	for (int i=0; i<10; i++)
+	if (address < USER_COUNT*LOAD_OFFSET)
+	{
+		unsigned int record = read_base()+record_of(address);
+		
+		/* Deleted record */
+		if (EEP::Read(record+STATUS_OFFSET) == STATUS_TOMB)
+		{
+			use.ID = 0xFF;
+			use.set_PW(0xFFFFFFFF);
+			for (int i=0; i<10; i++)
+			{
+				use.DATA[i] = 0xFF;
+			}
+			STAT_END(STAT_DB_READ);
+			return use;
+		}
+		
+		/* ID read */
+		long ID = EEP::Read(record+ID_OFFSET);
+		
+		/* Password read */
+		long PW0 = EEP::Read(record+PW_OFFSET);
+		long PW1 = EEP::Read(record+PW_OFFSET+1);
+		long PW2 = EEP::Read(record+PW_OFFSET+2);
+		long PW3 = EEP::Read(record+PW_OFFSET+3);
+		long PW = PW0+(PW1<<8)+(PW2<<16)+(PW3<<24);
+
+		use.ID = ID;
+		use.set_PW(PW);
+		
+#ifdef DB_EXTENTS
+		/* Extent of the Data */
+		byte first, length;
+		if (extent_of(record, &first, &length))
+		{
+			use.LENGTH = length;
+			use.EXTENT = first;
+		}
+		use.DATA[0] = 0x00;
+#else
+		/* Data read */
+		for (int i=0; i<10; i++)
+		{
+			use.DATA[i] = (byte)EEP::Read(record+DATA_OFFSET+i);
+		}
+#endif
+		
+		/* Empty record, fall through to program memory */
+		if (ID == 0xFF)
+		{
+			FLASH::Read(address/LOAD_OFFSET, &use);
+		}
+	}
+	else
 	{
-		use.DATA[i] = (byte)EEP::Read(address+DATA_OFFSET+i);
+		use.ID = 0xFF;
+		FLASH::Read(address/LOAD_OFFSET, &use);
 	}
 
+	STAT_END(STAT_DB_READ);
+	
 	/* User return */
 	return use;
-}
\ No newline at end of file
+}
+
+/*
+ * Looks up the User of a login ('user -l' and the keypad). Returns
+ * false for an ID out of range or without a User, which is appended
+ * to the audit log as a failed login with AUDIT. Only the Users found
+ * here are cached, an unknown ID does not take an entry.
+ */
+bool DB::Find(long ID, User* use)
+{
+	if ((ID >= 0) && (ID < FLASH_ID_LIMIT))
+	{
+		unsigned int address = ID*LOAD_OFFSET;
+#ifdef CACHE_SIZE
+		if (CACHE::lookup(address, use))
+		{
+			return true;
+		}
+#endif
+		*use = DB::Read(address);
+		if (use->ID != 0xFF)
+		{
+#ifdef CACHE_SIZE
+			CACHE::store(address, *use);
+#endif
+			return true;
+		}
+	}
+#ifdef AUDIT
+	LOG::Append(ID, false);
+#endif
+	return false;
+}
+
+/*
+ * Checks the Password of a User found with DB::Find and appends the
+ * result to the audit log with AUDIT.
+ */
+bool DB::Login(long ID, User& use, long PW)
+{
+	bool pass = use.authenticate(PW);
+#ifdef AUDIT
+	LOG::Append(ID, pass);
+#endif
+	return pass;
+}
+
+/*
+ * Deletes the record at the given address by writing only its status
+ * byte (STATUS_TOMB), which also hides a User of the same ID in program
+ * memory. The other bytes are left for DB::Scrub to erase later, the
+ * blocks of an extent are free at once (DB_EXTENTS). Returns
+ * false without writing anything if there is no User at the address,
+ * unless empty is set (a deleted record sent by sync --apply).
+ */
+bool DB::Delete(unsigned int address, bool empty)
+{
+	if (!empty && (DB::Read(address).ID == 0xFF))
+	{
+		return false;
+	}
+	warm();
+	
+	unsigned int record = write_base()+record_of(address);
+#ifdef DB_EXTENTS
+	byte first, length;
+	if (extent_of(record, &first, &length))
+	{
+		claim(first, blocks(length), false);
+	}
+#endif
+#ifdef DB_BANKS
+	unsigned int before = staging ? 0 : DB::Digest(record, true);
+#endif
+	EEP::Write(record+STATUS_OFFSET, STATUS_TOMB);
+	
+#ifdef DB_BANKS
+	if (staging)
+	{
+		set_staged(address);
+		return true;
+	}
+	bank_patch(active, address, before);
+#endif
+	
+#ifdef CACHE_SIZE
+	CACHE::forget(address);
+#endif
+	mark(address);
+	scrub_pending = true;
+	return true;
+}
+
+/*
+ * Returns the CRC-16 of the record stored at the given address. The
+ * 15 bytes owned by DB::Write (ID, Password and DATA) are covered,
+ * followed by the status byte. With DB_EXTENTS these are the ID,
+ * Password and length bytes of the header and the status byte, followed
+ * by the Data in the extent, so where the extent is does not matter.
+ * The host tools compute the same digest from the EEPROM image to find
+ * out which records have to be sent to the device (database/sync.py).
+ * The address is that of the served bank unless physical is set.
+ * The other bytes of a deleted record count as erased, so scrubbing it
+ * does not change the digest, but its status byte tells it apart from
+ * an erased record (it hides a User in program memory).
+ */
+unsigned int DB::Digest(unsigned int address, bool physical)
+{
+	if (!physical)
+	{
+		address = read_base()+record_of(address);
+	}
+	byte status = EEP::Read(address+STATUS_OFFSET);
+	bool deleted = (status == STATUS_TOMB);
+	unsigned int crc = 0xFFFF;
+#ifdef DB_EXTENTS
+	for (int i=0; i<=LENGTH_OFFSET; i++)
+	{
+		crc = _crc16_update(crc, deleted ? 0xFF : EEP::Read(address+i));
+	}
+	crc = _crc16_update(crc, status);
+	byte first, length;
+	if (extent_of(address, &first, &length))
+	{
+		for (byte i=0; i<length; i++)
+		{
+			crc = _crc16_update(crc, EEP::Read(extent_address(first)+i));
+		}
+	}
+#else
+	for (int i=0; i<LOAD_OFFSET-1; i++)
+	{
+		crc = _crc16_update(crc, deleted ? 0xFF : EEP::Read(address+i));
+	}
+	crc = _crc16_update(crc, status);
+#endif
+	return crc;
+}
+
+/*
+ * Returns the CRC-16 of the whole user table, calculated over the
+ * digests of each record in order of User ID. With DB_BANKS this is
+ * also the CRC kept in the header of each bank.
+ */
+unsigned int DB::Digest()
+{
+	unsigned int crc = 0xFFFF;
+	for (int i=0; i<USER_COUNT; i++)
+	{
+		unsigned int digest = DB::Digest(i*LOAD_OFFSET);
+		crc = _crc16_update(crc, digest);
+		crc = _crc16_update(crc, digest>>8);
+	}
+	return crc;
+}
+
+/*
+ * Returns the number of bytes of the Data of a User.
+ */
+byte DB::Length(const User& use)
+{
+#ifdef DB_EXTENTS
+	return use.LENGTH;
+#else
+	return strnlen((const char*)use.DATA, 10);
+#endif
+}
+
+/*
+ * Returns one byte of the Data of a User. With DB_EXTENTS the byte is
+ * read from the extent in EEPROM, unless the User is not from EEPROM
+ * (program memory or made in SRAM) and has its Data in DATA.
+ */
+byte DB::Data(const User& use, byte index)
+{
+#ifdef DB_EXTENTS
+	if (use.EXTENT != EXTENT_NONE)
+	{
+		return EEP::Read(extent_address(use.EXTENT)+index);
+	}
+#endif
+	return use.DATA[index];
+}
+
+/*
+ * Passes the Data of a User to put one byte at a time, e.g. UART::Send,
+ * so it never has to be held in SRAM as a whole.
+ */
+void DB::Stream(const User& use, void (*put)(byte))
+{
+	byte length = DB::Length(use);
+	for (byte i=0; i<length; i++)
+	{
+		put(DB::Data(use, i));
+	}
+}
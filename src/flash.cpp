@@ -0,0 +1,72 @@
+/*
+ * flash.cpp
+ *
+ * Created: 10/19/2026 6:13:20 PM
+ *  Author: Usama Mustafa
+ */ 
+
+#include "flashdb.h"
+
+
+/*
+ * Returns the number of Users in the program memory table.
+ */
+unsigned int FLASH::Count()
+{
+	return flash_count;
+}
+
+/*
+ * Decodes the User at the given position of the table into use.
+ * Returns false if there is no such position.
+ */
+bool FLASH::At(unsigned int index, User* use)
+{
+	if (index >= flash_count)
+	{
+		return false;
+	}
+	FlashUser entry;
+	memcpy_P(&entry, &flash_users[index], sizeof(FlashUser));
+	use->ID = entry.ID;
+	use->set_PW(entry.PW);
+	for (int i=0; i<10; i++)
+	{
+		use->DATA[i] = entry.DATA[i];
+	}
+	use->DATA[10] = 0x00;
+	use->ADDRESS = entry.ID * LOAD_OFFSET;
+#ifdef DB_EXTENTS
+	use->LENGTH = strnlen((const char*)use->DATA, 10);
+	use->EXTENT = EXTENT_NONE;
+#endif
+	return true;
+}
+
+/*
+ * Looks up a User ID with a binary search over the table. Returns
+ * false and leaves use untouched if the ID is not in the table.
+ */
+bool FLASH::Read(long ID, User* use)
+{
+	unsigned int low = 0;
+	unsigned int high = flash_count;
+	while (low < high)
+	{
+		unsigned int middle = (low + high) / 2;
+		unsigned int id = pgm_read_word(&flash_users[middle].ID);
+		if (id == ID)
+		{
+			return FLASH::At(middle, use);
+		}
+		if (id < ID)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,16 @@
+/*
+ * flashdb.cpp
+ *
+ * Generated by database.py from database.csv. Do not edit, edit
+ * the CSV file and run database.bat (or database.py) instead.
+ */ 
+
+#include "flashdb.h"
+
+
+const unsigned int flash_count = 0;
+
+const FlashUser flash_users[] PROGMEM =
+{
+	{0xFFFF, 0L, {0}}
+};
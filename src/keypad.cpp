@@ -0,0 +1,222 @@
+/*
+ * keypad.cpp
+ *
+ * Created: 10/20/2026 12:22:10 AM
+ *  Author: Usama Mustafa
+ */ 
+
+#include "keypad.h"
+
+#ifdef KEYPAD
+
+#include "eepio.h"
+#include "lcd.h"
+#include "timer.h"
+#include <avr/pgmspace.h>
+#include <util/delay.h>
+
+#define ROWS    0x0F
+#define COLUMNS (0x07<<KEYPAD_COL_SHIFT)
+
+/* Timer1 ticks of KEYPAD_DEBOUNCE */
+#define DEBOUNCE_TICKS (F_CPU/1000UL*KEYPAD_DEBOUNCE/TIMER_PRESCALER)
+
+/* Entry states */
+#define PAD_IDLE 0
+#define PAD_ID   1
+#define PAD_PIN  2
+
+/* Keys by row, then column. */
+const char pad_keys[] PROGMEM = "123456789*0#";
+
+/* Key ring, written by the interrupt at key_head and read by
+   PAD::Step at key_tail. */
+static volatile byte keys[KEYPAD_RING];
+static volatile byte key_head = 0;
+static volatile byte key_tail = 0;
+
+/* Tick of the last change of the rows, seen by the interrupt only. */
+static unsigned long changed = 0;
+
+static byte state = PAD_IDLE;
+static long number = 0;
+static byte digits = 0;
+static long user_id = 0;
+static unsigned long last_key = 0;
+
+ISR(KEYPAD_vect)
+{
+	unsigned long now = TIMER::ticks();
+	bool quiet = (now - changed) >= DEBOUNCE_TICKS;
+	changed = now;
+	if (!quiet || ((KEYPAD_ROW_PIN & ROWS) == ROWS))
+	{
+		return;
+	}
+	
+	/* Only one column low at a time, the others pulled up. */
+	KEYPAD_COL_DDR &= ~COLUMNS;
+	KEYPAD_COL_PORT |= COLUMNS;
+	for (byte column=0; column<3; column++)
+	{
+		byte pin = (1<<(KEYPAD_COL_SHIFT+column));
+		KEYPAD_COL_PORT &= ~pin;
+		KEYPAD_COL_DDR |= pin;
+		_delay_us(5);
+		byte rows = KEYPAD_ROW_PIN & ROWS;
+		KEYPAD_COL_DDR &= ~pin;
+		KEYPAD_COL_PORT |= pin;
+		if (rows != ROWS)
+		{
+			byte row = 0;
+			while (rows & (1<<row))
+			{
+				row++;
+			}
+			byte next = (key_head+1) & (KEYPAD_RING-1);
+			if (next != key_tail)
+			{
+				keys[key_head] = pgm_read_byte(&pad_keys[row*3+column]);
+				key_head = next;
+			}
+			break;
+		}
+	}
+	KEYPAD_COL_PORT &= ~COLUMNS;
+	KEYPAD_COL_DDR |= COLUMNS;
+	
+	/* The scan itself changed the rows. */
+	PCIFR = (1<<KEYPAD_PCIF);
+}
+
+/*
+ * Sets up the keypad pins and enables the pin change interrupt of the
+ * rows. Interrupts are enabled globally by TIMER::Init. With KEYPAD_JTAG
+ * the JTAG interface is turned off first, JTD has to be written twice
+ * within four cycles, so interrupts are held off around the two writes.
+ */
+void PAD::Init()
+{
+#ifdef KEYPAD_JTAG
+	byte sreg = SREG;
+	cli();
+	byte mcucr = MCUCR | (1<<JTD);
+	MCUCR = mcucr;
+	MCUCR = mcucr;
+	SREG = sreg;
+#endif
+	KEYPAD_ROW_DDR &= ~ROWS;
+	KEYPAD_ROW_PORT |= ROWS;
+	KEYPAD_COL_PORT &= ~COLUMNS;
+	KEYPAD_COL_DDR |= COLUMNS;
+	KEYPAD_PCMSK |= ROWS;
+	PCIFR = (1<<KEYPAD_PCIF);
+	PCICR |= (1<<KEYPAD_PCIE);
+}
+
+static void start(const char* label)
+{
+	LCD::command(CLEAR);
+	LCD::print(label);
+	number = 0;
+	digits = 0;
+}
+
+static void result(const char* message)
+{
+	LCD::command(CLEAR);
+	LCD::print(message);
+	state = PAD_IDLE;
+}
+
+/* The entered User ID, checked as in CMD::User_Login. */
+static void enter_id()
+{
+	User use;
+	user_id = number;
+	if (!DB::Find(user_id, &use))
+	{
+		result("No user");
+		return;
+	}
+	LCD::command(NEXTLINE);
+	LCD::print("PIN: ");
+	number = 0;
+	digits = 0;
+	state = PAD_PIN;
+}
+
+/* The entered PIN. The User is looked up again, it may have been
+   deleted on the UART since the ID was entered. */
+static void enter_pin()
+{
+	User use;
+	if (DB::Find(user_id, &use) && DB::Login(user_id, use, number))
+	{
+		DB::display(use);
+		state = PAD_IDLE;
+	}
+	else
+	{
+		result("Denied");
+	}
+}
+
+/* True while an ID or PIN is being entered. */
+bool PAD::Busy()
+{
+	return (state != PAD_IDLE);
+}
+
+/*
+ * Handles the keys pressed since the last call. Does not send on the
+ * UART, so it can be called while the UART waits for the transmitter.
+ */
+void PAD::Step()
+{
+	if ((state != PAD_IDLE) && (TIMER::uptime() - last_key >= KEYPAD_TIMEOUT))
+	{
+		LCD::command(CLEAR);
+		state = PAD_IDLE;
+	}
+	
+	while (key_tail != key_head)
+	{
+		byte key = keys[key_tail];
+		key_tail = (key_tail+1) & (KEYPAD_RING-1);
+		last_key = TIMER::uptime();
+		
+		if (key == '*')
+		{
+			start("ID: ");
+			state = PAD_ID;
+		}
+		else if (key == '#')
+		{
+			if (state == PAD_ID)
+			{
+				enter_id();
+			}
+			else if (state == PAD_PIN)
+			{
+				enter_pin();
+			}
+		}
+		else
+		{
+			if (state == PAD_IDLE)
+			{
+				start("ID: ");
+				state = PAD_ID;
+			}
+			if (digits < KEYPAD_DIGITS)
+			{
+				number = number*10 + (key-'0');
+				digits++;
+				LCD::display((state == PAD_PIN) ? '*' : key);
+			}
+		}
+	}
+}
+
+#endif
@@ -6,8 +6,25 @@
  */ 
 
 #include "lcd.h"
+#include "stats.h"
+#include "eepio.h"
+#include "timer.h"
 
 
+/* Timer1 ticks of LCD_T_POWER, compared with the ticks themselves
+   because TIMER::us of the uptime overflows after a few minutes. */
+#define POWER_TICKS (F_CPU/1000000UL*LCD_T_POWER/TIMER_PRESCALER)
+
+/* LCD::Init has been run. */
+static bool on = false;
+
+/* The "ID: " and "DATA: " labels of DB::display are on the screen. */
+static bool labels = false;
+
+/* Lengths of the fields last written by DB::display. */
+static byte id_length = 0;
+static byte data_length = 0;
+
 /*
  *
  * Initializes the LCD by setting the initial boot sequence and set-up 
@@ -18,27 +35,51 @@
  * Cursor:  				Off
  * Blink:   				Off
  * Font:    				5x8
- * Interface Data Length:	4-bit
+ * Interface Data Length:	4-bit (8-bit with LCD_8BIT)
  * Line Mode:				2-line
  * 
- * The four LCD data bits are [PD4, PD5, PD6, PD7]
+ * The four LCD data bits are [PD4, PD5, PD6, PD7], all of PORTA with
+ * LCD_8BIT.
  * The three LCD control bits are [PB0, PB1, PB2]
+ * (LCD_DATA_PORT and LCD_CTRL_PORT in board.h)
+ * 
+ * The LCD needs LCD_T_POWER after power-on before the first command.
+ * That time is counted from TIMER::Init, which has to be run first,
+ * and only what is left of it is waited for here. Other LCD functions
+ * call Init if it has not been run yet.
  * 
  */ 
 void LCD::Init()
 {
-	DDRD = 0xF0;
-	DDRB = 0x07;
+	while (TIMER::ticks() < POWER_TICKS);
+	
+	LCD_DATA_DDR = LCD_DATA_MASK;
+	LCD_CTRL_DDR |= 0x07;
 	
-	PORTD = FUNCTION_SET;
-	_toggle_control_command();
-	_delay_ms(1);
+	/* The LCD starts with an 8 bit interface, the first function set
+	   is a single transfer of the high nibble. */
+	LCD_DATA_PORT = FUNCTION_SET;
+	_toggle_control(0);
+	_delay_us(LCD_T_EXEC);
+	on = true;
 	LCD::command(FUNCTION_SET);
-	_delay_ms(1);
 	LCD::command(DISPLAY_ON);
-	_delay_ms(1);
 	LCD::command(ENTRY_MODE);
-	_delay_ms(1);
+	labels = false;
+}
+
+/*
+ * Runs LCD::Init once the power-on time has passed, without waiting.
+ * Meant to be called while waiting for input. Returns true once the
+ * LCD is set up.
+ */
+bool LCD::Warm()
+{
+	if (!on && (TIMER::ticks() >= POWER_TICKS))
+	{
+		LCD::Init();
+	}
+	return on;
 }
 
 /*
@@ -46,10 +87,15 @@ void LCD::Init()
  */
 void LCD::command(byte comm)
 {
-	PORTD = (comm & 0xF0);
-	_toggle_control_command();
-	PORTD = (comm & 0x0F) << 4;
-	_toggle_control_command();
+	if (!on)
+	{
+		LCD::Init();
+	}
+	
+	/* Anything but DB::display may change what is on the screen. */
+	labels = false;
+	_check_bf();
+	_write(comm, 0);
 }
 
 /*
@@ -57,11 +103,28 @@ void LCD::command(byte comm)
  */
 void LCD::display(byte character)
 {
-	LCD::_check_bf();
-	PORTD = (character & 0xF0);
-	_toggle_control_display();
-	PORTD = (character & 0x0F) << 4;
-	_toggle_control_display();
+	if (!on)
+	{
+		LCD::Init();
+	}
+	STAT_BEGIN(STAT_LCD_CHAR);
+	_check_bf();
+	_write(character, RS);
+	STAT_END(STAT_LCD_CHAR);
+}
+
+/*
+ * Moves the cursor to the given column of the first (0) or second (1)
+ * row, the next character is displayed there.
+ */
+void LCD::position(byte row, byte column)
+{
+	if (!on)
+	{
+		LCD::Init();
+	}
+	_check_bf();
+	_write(SET_DDRAM | (row ? 0x40 : 0x00) | column, 0);
 }
 
 /*
@@ -69,6 +132,8 @@ void LCD::display(byte character)
  */
 void LCD::print(const char* array)
 {
+	labels = false;
+	
 	/* Move the array to a disposable variable. */
 	const char* buffer = array;
 	
@@ -125,59 +190,84 @@ void LCD::print(double number)
 	free(buffer);
 }
 
-inline void LCD::_toggle_control_command()
+/*
+ * One E cycle of a write with the given RS. The data lines have to be
+ * set already.
+ */
+inline void LCD::_toggle_control(byte control)
 {
-	PORTB = 0;
-	_delay_us(DELAY);
-	PORTB = E;
-	_delay_us(DELAY);
-	PORTB = 0;
-	_delay_us(DELAY);
+	LCD_CTRL_PORT = control;
+	_delay_us(LCD_T_AS);
+	LCD_CTRL_PORT = control|E;
+	_delay_us(LCD_T_PW);
+	LCD_CTRL_PORT = control;
+	_delay_us(LCD_T_CYCLE-LCD_T_PW);
 }
 
-inline void LCD::_toggle_control_display()
+/*
+ * Writes a byte, as one transfer with LCD_8BIT or as two nibbles.
+ */
+inline void LCD::_write(byte value, byte control)
 {
-	PORTB = RS;
-	_delay_us(DELAY);
-	PORTB = RS|E;
-	_delay_us(DELAY);
-	PORTB = RS;
-	_delay_us(DELAY);
+#ifdef LCD_8BIT
+	LCD_DATA_PORT = value;
+	_toggle_control(control);
+#else
+	LCD_DATA_PORT = (value & 0xF0);
+	_toggle_control(control);
+	LCD_DATA_PORT = (value & 0x0F) << 4;
+	_toggle_control(control);
+#endif
 }
 
 /* 
  * Checks the busy flag from LCD. Does not return the function
- * as long as the LCD is busy
+ * as long as the LCD is busy. The flag is read while E is high.
  */
 inline void LCD::_check_bf()
 {
+	STAT_BEGIN(STAT_LCD_BF);
 	byte BF = 0x00;
+	LCD_DATA_PORT = 0x00;
+	LCD_DATA_DDR = 0x00;
 	do
 	{
-		PORTD = 0x00;
-		DDRD = 0x00;
-		PORTB = RW;
-		_delay_us(DELAY);
-		PORTB = RW|E;
-		_delay_us(DELAY);
-		PORTB = RW;
-		_delay_us(DELAY);
-		BF = PIND>>7;
-		PORTB = RW;
-		_delay_us(DELAY);
-		PORTB = RW|E;
-		_delay_us(DELAY);
-		PORTB = RW;
-		_delay_us(DELAY);
+		LCD_CTRL_PORT = RW;
+		_delay_us(LCD_T_AS);
+		LCD_CTRL_PORT = RW|E;
+		_delay_us(LCD_T_DDR);
+		BF = LCD_DATA_PIN & 0x80;
+		_delay_us(LCD_T_PW-LCD_T_DDR);
+		LCD_CTRL_PORT = RW;
+		_delay_us(LCD_T_CYCLE-LCD_T_PW);
+#ifndef LCD_8BIT
+		/* The low nibble (address counter) completes the read. */
+		LCD_CTRL_PORT = RW|E;
+		_delay_us(LCD_T_PW);
+		LCD_CTRL_PORT = RW;
+		_delay_us(LCD_T_CYCLE-LCD_T_PW);
+#endif
 	}
-	while(!BF);
-	DDRD = 0xF0;
+	while(BF);
+	LCD_DATA_DDR = LCD_DATA_MASK;
+	STAT_END(STAT_LCD_BF);
 }
 
-inline void LCD::_clear()
+/*
+ * Writes a field of DB::display at the cursor and blanks what is left
+ * of the previous value, whose length is updated.
+ */
+static void field(const byte* text, byte length, byte* previous)
 {
-	LCD::command(CLEAR);
-	_delay_ms(2.5);
+	for (byte i=0; i<length; i++)
+	{
+		LCD::display(text[i]);
+	}
+	for (byte i=length; i<*previous; i++)
+	{
+		LCD::display(' ');
+	}
+	*previous = length;
 }
 
 /*
@@ -186,10 +276,33 @@ inline void LCD::_clear()
  */
 void DB::display(User use)
 {
-	LCD::_clear();
-	LCD::print("ID: ");
-	LCD::print(use.ID);
-	LCD::command(NEXTLINE);
-	LCD::print("DATA: ");
-	LCD::print((const char*)use.DATA);
-}
\ No newline at end of file
+	if (!labels)
+	{
+		LCD::command(CLEAR);
+		LCD::print("ID: ");
+		LCD::command(NEXTLINE);
+		LCD::print("DATA: ");
+		id_length = 0;
+		data_length = 0;
+		labels = true;
+	}
+	
+	char number[12];
+	ltoa(use.ID, number, 10);
+	LCD::position(0, 4);
+	field((const byte*)number, strlen(number), &id_length);
+	
+	/* Only 10 characters fit after the label. */
+	byte data[10];
+	byte length = DB::Length(use);
+	if (length > 10)
+	{
+		length = 10;
+	}
+	for (byte i=0; i<length; i++)
+	{
+		data[i] = DB::Data(use, i);
+	}
+	LCD::position(1, 6);
+	field(data, length, &data_length);
+}
\ No newline at end of file
@@ -0,0 +1,155 @@
+/*
+ * mem.cpp
+ *
+ * Created: 10/19/2026 1:47:31 PM
+ *  Author: Usama Mustafa
+ */ 
+
+#include "mem.h"
+#include "serialio.h"
+#include "output.h"
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+
+/* Internals of malloc in avr-libc. */
+struct __freelist
+{
+	size_t sz;
+	struct __freelist *nx;
+};
+
+extern "C"
+{
+	extern char __heap_start;
+	extern char* __brkval;
+	extern struct __freelist* __flp;
+}
+
+static unsigned int heap_peak = 0;
+
+/*
+ * Paints the memory between the end of .bss and the top of SRAM
+ * before main runs. Must not call anything or use the stack, hence
+ * naked. Placed in .init3, after .init2 has cleared r1 (which the
+ * compiled code takes as zero) and set SP, and before .data and .bss
+ * are set up, which lie below the painted memory anyway.
+ */
+extern "C" void paint_stack(void) __attribute__ ((naked, used, section (".init3")));
+
+extern "C" void paint_stack(void)
+{
+	byte* p = (byte*)&__heap_start;
+	while (p <= (byte*)RAMEND)
+	{
+		*p = STACK_CANARY;
+		p++;
+	}
+}
+
+static char* heap_end()
+{
+	return (__brkval == 0) ? &__heap_start : __brkval;
+}
+
+void MEM::sample()
+{
+	unsigned int top = heap_end() - &__heap_start;
+	if (top > heap_peak)
+	{
+		heap_peak = top;
+	}
+}
+
+MEM::Info MEM::read()
+{
+	MEM::sample();
+	
+	Info info;
+	char* end = heap_end();
+	char* peak = &__heap_start + heap_peak;
+	char* sp = (char*)SP;
+	
+	/* Stack: the untouched paint above the heap ends at the deepest
+	   point the stack has reached. The scan starts at the highest end
+	   the heap has had, as free() lowers __brkval but leaves the bytes
+	   it gave back dirty. */
+	char* p = peak;
+	while ((p < sp) && (*(byte*)p == STACK_CANARY))
+	{
+		p++;
+	}
+	info.stack_now = (char*)RAMEND - sp;
+	info.stack_peak = (char*)RAMEND - p + 1;
+	info.gap_now = sp - end;
+	info.gap_min = p - peak;
+	
+	/* Heap: walk the free list. Every block has a 2 byte size header. */
+	info.heap_top = end - &__heap_start;
+	info.heap_peak = heap_peak;
+	info.heap_free = 0;
+	info.heap_blocks = 0;
+	info.heap_largest = 0;
+	for (struct __freelist* block = __flp; block != 0; block = block->nx)
+	{
+		info.heap_free += block->sz + sizeof(size_t);
+		info.heap_blocks++;
+		if (block->sz > info.heap_largest)
+		{
+			info.heap_largest = block->sz;
+		}
+	}
+	info.heap_used = info.heap_top - info.heap_free;
+	return info;
+}
+
+const char mem_0[] PROGMEM = "stack.now ";
+const char mem_1[] PROGMEM = "stack.peak ";
+const char mem_2[] PROGMEM = "heap.top ";
+const char mem_3[] PROGMEM = "heap.peak ";
+const char mem_4[] PROGMEM = "heap.used ";
+const char mem_5[] PROGMEM = "heap.free ";
+const char mem_6[] PROGMEM = "heap.blocks ";
+const char mem_7[] PROGMEM = "heap.largest ";
+const char mem_8[] PROGMEM = "gap.now ";
+const char mem_9[] PROGMEM = "gap.min ";
+const char mem_10[] PROGMEM = "uart.dropped ";
+
+static void line(PGM_P name, unsigned int value)
+{
+	if (!OUT::text())
+	{
+		OUT::pair(name, value);
+		return;
+	}
+	SIO::pgm_printf(name);
+	SIO::printf((long)value);
+	SIO::printf("\r");
+}
+
+/*
+ * Prints the memory report, one "name value" pair per line (a name,value
+ * record in the machine-readable modes), and the bytes the receive ring
+ * has dropped since boot. This is the output of the 'mem' command and is
+ * parsed by database/loadgen.py and bench.py.
+ */
+void MEM::print()
+{
+	Info info = MEM::read();
+	line(mem_0, info.stack_now);
+	line(mem_1, info.stack_peak);
+	line(mem_2, info.heap_top);
+	line(mem_3, info.heap_peak);
+	line(mem_4, info.heap_used);
+	line(mem_5, info.heap_free);
+	line(mem_6, info.heap_blocks);
+	line(mem_7, info.heap_largest);
+	line(mem_8, info.gap_now);
+	line(mem_9, info.gap_min);
+	
+	/* Written by the receive interrupt, and two bytes wide. */
+	byte sreg = SREG;
+	cli();
+	unsigned int dropped = UART::dropped;
+	SREG = sreg;
+	line(mem_10, dropped);
+}
@@ -0,0 +1,222 @@
+/*
+ * output.cpp
+ *
+ * Created: 10/19/2026 11:03:12 PM
+ *  Author: Usama Mustafa
+ */
+
+#include "output.h"
+#include "serialio.h"
+
+static byte mode = OUT_TEXT;
+static byte error = OUT_OK;
+static unsigned int records = 0;
+static byte fields = 0;
+
+const char out_0[] PROGMEM = "text";
+const char out_1[] PROGMEM = "csv";
+const char out_2[] PROGMEM = "tsv";
+const char out_3[] PROGMEM = "kv";
+
+PGM_P const out_modes[] PROGMEM =
+{
+	out_0,
+	out_1,
+	out_2,
+	out_3
+};
+
+const char code_0[] PROGMEM = "";
+const char code_1[] PROGMEM = "denied";
+const char code_2[] PROGMEM = "no_user";
+const char code_3[] PROGMEM = "invalid";
+const char code_4[] PROGMEM = "full";
+const char code_5[] PROGMEM = "unknown";
+
+PGM_P const out_errors[] PROGMEM =
+{
+	code_0,
+	code_1,
+	code_2,
+	code_3,
+	code_4,
+	code_5
+};
+
+const char status_0[] PROGMEM = "status";
+const char status_1[] PROGMEM = "records";
+const char status_2[] PROGMEM = "error";
+
+const char pair_0[] PROGMEM = "name";
+const char pair_1[] PROGMEM = "value";
+
+static byte separator()
+{
+	return (mode == OUT_TSV) ? TAB : ((mode == OUT_KV) ? ' ' : ',');
+}
+
+/* Separator before every field but the first, and the key in kv mode. */
+static void key(PGM_P name)
+{
+	if (fields++ > 0)
+	{
+		UART::Send(separator());
+	}
+	if (mode == OUT_KV)
+	{
+		SIO::pgm_printf(name);
+		UART::Send('=');
+	}
+}
+
+/* Decimal digits from the most significant one, without a buffer. */
+static void number(unsigned long value)
+{
+	unsigned long scale = 1;
+	while (value/scale >= 10)
+	{
+		scale *= 10;
+	}
+	do
+	{
+		UART::Send('0' + (value/scale)%10);
+		scale /= 10;
+	}
+	while (scale > 0);
+}
+
+/*
+ * Sets the output mode by name. Returns false, and keeps the mode, if
+ * the name is not one of text, csv, tsv or kv.
+ */
+bool OUT::Set(const char* name)
+{
+	for (byte i=OUT_TEXT; i<=OUT_KV; i++)
+	{
+		if (strcmp_P(name, (PGM_P)pgm_read_word(&out_modes[i])) == 0)
+		{
+			mode = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Prints the name of the current mode. */
+void OUT::show()
+{
+	SIO::pgm_printf((PGM_P)pgm_read_word(&out_modes[mode]));
+	UART::Send('\r');
+}
+
+/* Whether commands should print their text messages. */
+bool OUT::text()
+{
+	return mode == OUT_TEXT;
+}
+
+void OUT::begin()
+{
+	error = OUT_OK;
+	records = 0;
+	fields = 0;
+}
+
+/* Marks the command as failed. The first error is the one reported. */
+void OUT::fail(byte code)
+{
+	if (error == OUT_OK)
+	{
+		error = code;
+	}
+}
+
+/*
+ * Prints the status line that ends the output of every command in the
+ * machine-readable modes.
+ */
+void OUT::status()
+{
+	if (mode == OUT_TEXT)
+	{
+		return;
+	}
+	fields = 0;
+	key(status_0);
+	SIO::printf(error == OUT_OK ? "OK" : "ERR");
+	if (error == OUT_OK)
+	{
+		key(status_1);
+		number(records);
+	}
+	else
+	{
+		key(status_2);
+		SIO::pgm_printf((PGM_P)pgm_read_word(&out_errors[error]));
+	}
+	UART::Send('\r');
+	fields = 0;
+}
+
+void OUT::field(PGM_P name, long value)
+{
+	key(name);
+	if (value < 0)
+	{
+		UART::Send('-');
+		value = -value;
+	}
+	number(value);
+}
+
+/*
+ * Starts a data field, its bytes are then passed to put one by one,
+ * e.g. by DB::Stream.
+ */
+void OUT::field(PGM_P name)
+{
+	key(name);
+}
+
+/* One byte of a data field, escaped if needed. */
+void OUT::put(byte c)
+{
+	if ((c < ' ') | (c > '~') | (c == '%') | (c == separator()) | ((mode == OUT_KV) & (c == '=')))
+	{
+		UART::Send('%');
+		SIO::hex(c);
+	}
+	else
+	{
+		UART::Send(c);
+	}
+}
+
+/* Ends the current record. */
+void OUT::end()
+{
+	UART::Send('\r');
+	records++;
+	fields = 0;
+}
+
+/*
+ * Prints a name of a report as a field. The names are padded with
+ * spaces to line up the text mode, which is left out here.
+ */
+void OUT::name(PGM_P key, PGM_P text)
+{
+	OUT::field(key);
+	byte c;
+	while (((c = pgm_read_byte(text++)) != '\0') && (c != ' '))
+	{
+		OUT::put(c);
+	}
+}
+
+void OUT::pair(PGM_P text, long value)
+{
+	OUT::name(pair_0, text);
+	OUT::field(pair_1, value);
+	OUT::end();
+}
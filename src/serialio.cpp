@@ -6,6 +6,32 @@
  */ 
 
 # include "serialio.h"
+# include "stats.h"
+# include "eepio.h"
+# include "mem.h"
+# include <avr/interrupt.h>
+
+
+/* Receive ring, written by the interrupt at rx_head and read by
+   UART::Receive at rx_tail. One byte each, so no locking is needed. */
+static volatile byte rx_buffer[RX_SIZE];
+static volatile byte rx_head = 0;
+static volatile byte rx_tail = 0;
+
+volatile unsigned int UART::dropped = 0;
+
+ISR(BOARD_UART_RX_vect)
+{
+	byte data = UDR0;
+	byte next = (rx_head+1) & (RX_SIZE-1);
+	if (next == rx_tail)
+	{
+		UART::dropped++;
+		return;
+	}
+	rx_buffer[rx_head] = data;
+	rx_head = next;
+}
 
 
 /*
@@ -23,8 +49,9 @@ void UART::Init(unsigned int ubrr)
 	/*set double speed operation to reduce Baud rate Error*/
 	UCSR0A |= (1<<U2X0);
 	
-	/* Enable receiver and transmitter */
-	UCSR0B = (1<<RXEN0)|(1<<TXEN0);
+	/* Enable receiver, its interrupt and transmitter. Interrupts
+	   are enabled globally by TIMER::Init. */
+	UCSR0B = (1<<RXEN0)|(1<<RXCIE0)|(1<<TXEN0);
 	
 	/* Set frame format: 8data, 2stop bit */
 	//UCSR0C = (1<<USBS0)|(3<<UCSZ00);
@@ -33,17 +60,29 @@ void UART::Init(unsigned int ubrr)
 	UCSR0C = (3<<UCSZ00);
 }
 
+void (*UART::idle)(void) = 0;
+void (*UART::busy)(void) = 0;
+
 /* 
- * Returns only one byte of data received by the MCU.
- * This is done using polling and interrupts are not used.
+ * Returns only one byte of data received by the MCU, the oldest
+ * one in the receive ring. While waiting, the idle hook gets to do
+ * small pieces of work.
  */
 byte UART::Receive()
 {
 	/* Wait for data to be received */
-	while ( !(UCSR0A & (1<<RXC0)) );
+	while (rx_tail == rx_head)
+	{
+		if (UART::idle)
+		{
+			UART::idle();
+		}
+	}
 	
 	/* Get and return received data from buffer */
-	return UDR0;
+	byte data = rx_buffer[rx_tail];
+	rx_tail = (rx_tail+1) & (RX_SIZE-1);
+	return data;
 }
 
 /* 
@@ -51,8 +90,19 @@ byte UART::Receive()
  */
 void UART::Send(byte data)
 { 
-	/* Wait for empty transmit buffer */
-	while ( !( UCSR0A & (1<<UDRE0)) );
+	/* Wait for empty transmit buffer, measuring only real stalls */
+	if ( !( UCSR0A & (1<<UDRE0)) )
+	{
+		STAT_BEGIN(STAT_UART_WAIT);
+		while ( !( UCSR0A & (1<<UDRE0)) )
+		{
+			if (UART::busy)
+			{
+				UART::busy();
+			}
+		}
+		STAT_END(STAT_UART_WAIT);
+	}
 	   
 	/* Put data into buffer, sends the data */
 	UDR0 = data;
@@ -68,6 +118,7 @@ void SIO::printf(int number)
 {
 	/* Allocate memory for a int no more than 10 digits long. */
 	char* buffer = (char*)malloc(sizeof(char)*10);
+	MEM::sample();
 	
 	/* Conversion to string. */
 	SIO::printf(itoa(number, buffer, 10));
@@ -84,6 +135,7 @@ void SIO::printf(long number)
 {
 	/* Allocate memory for a int no more than 10 digits long. */
 	char* buffer = (char*)malloc(sizeof(char)*10);
+	MEM::sample();
 	
 	/* Conversion to string. */
 	SIO::printf(ltoa(number, buffer, 10));
@@ -101,6 +153,7 @@ void SIO::printf(double number)
 {
 	/* Allocate memory for a double no more than 9 digits long. */
 	char* buffer = (char*)malloc(sizeof(char)*10);
+	MEM::sample();
 	
 	/* Conversion to string. */
 	SIO::printf(dtostrf(number, 10, 4, buffer));
@@ -127,20 +180,43 @@ void SIO::printf(const char* array)
 	/*UART::Send(ENDL);*/
 }
 
+/*
+ * Prints a single byte as two hexadecimal digits. Used by the
+ * host protocol commands where a fixed width is easier to parse.
+ */
+void SIO::hex(byte data)
+{
+	const char digits[] = "0123456789ABCDEF";
+	UART::Send(digits[data>>4]);
+	UART::Send(digits[data&0x0F]);
+}
+
+/*
+ * Prints a string kept in program memory (PROGMEM).
+ */
+void SIO::pgm_printf(PGM_P line)
+{
+	byte c;
+	while ((c = pgm_read_byte(line++)) != '\0')
+	{
+		UART::Send(c);
+	}
+}
+
 void SIO::printf(User use)
 {
 	printf("ID: ");
 	printf(use.ID);
 	printf("\r");
 	printf("Data: ");
-	printf((const char*)use.DATA);
+	DB::Stream(use, UART::Send);
 	printf("\r");
 }
 
 /*
  * This overload of scanf function takes a string from user.
  * This function will not return as long as the user has not
- * typed 20 characters or the user has not pressed line break
+ * typed SCANF_SIZE-1 characters or the user has not pressed line break
  * (Enter) key.
  */
 const char* SIO::scanf()
@@ -148,7 +224,8 @@ const char* SIO::scanf()
 	/* Allocate the memory and initialize it with zeros so 
 	   as to stop the corruption of data and the mix-up with
 	   previously stored data. */
-	char* buffer = (char*)calloc(20, sizeof(char));
+	char* buffer = (char*)calloc(SCANF_SIZE, sizeof(char));
+	MEM::sample();
 	int i = 0;
 	byte REC;
 	
@@ -167,7 +244,7 @@ const char* SIO::scanf()
 		*(buffer+i) = REC;
 		i++;
 	}
-	while(i < 20);
+	while(i < SCANF_SIZE-1);
 	return buffer;
 }
 
@@ -183,7 +260,8 @@ const char* SIO::_scanf()
 	/* Allocate the memory and initialize it with zeros so 
 	   as to stop the corruption of data and the mix-up with
 	   previously stored data. */
-	char* buffer = (char*)calloc(20, sizeof(char));
+	char* buffer = (char*)calloc(SCANF_SIZE, sizeof(char));
+	MEM::sample();
 	int i = 0;
 	byte REC;
 
@@ -202,7 +280,7 @@ const char* SIO::_scanf()
 		*(buffer+i) = REC;
 		i++;
 	}
-	while(i < 20);
+	while(i < SCANF_SIZE-1);
 	return buffer;
 }
 
@@ -216,3 +294,50 @@ const char* SIO::scanf(const char* array)
 	SIO::printf(array);
 	return SIO::scanf();
 }
+
+/*
+ * Reads a number typed by the user. The buffer allocated by
+ * scanf is released here so the caller does not have to.
+ */
+long SIO::scanl()
+{
+	char* buffer = (char*)SIO::scanf();
+	long number = atol(buffer);
+	free(buffer);
+	return number;
+}
+
+/*
+ * Same as scanl but echoes aestrisks (*) like _scanf.
+ */
+long SIO::_scanl()
+{
+	char* buffer = (char*)SIO::_scanf();
+	long number = atol(buffer);
+	free(buffer);
+	return number;
+}
+
+/*
+ * Reads a line into the provided buffer without echoing it back.
+ * This is meant for host tools sending machine generated lines, so
+ * nothing is allocated and the line is always null terminated. At most
+ * size-1 characters are stored, the rest of the line is discarded.
+ * Returns the number of characters stored.
+ */
+int SIO::read(char* buffer, int size)
+{
+	int i = 0;
+	byte REC;
+	
+	while ((REC = UART::Receive()) != ENDL)
+	{
+		if (i < size-1)
+		{
+			buffer[i] = REC;
+			i++;
+		}
+	}
+	buffer[i] = '\0';
+	return i;
+}
@@ -0,0 +1,121 @@
+/*
+ * stats.cpp
+ *
+ * Created: 10/19/2026 9:31:44 AM
+ *  Author: Usama Mustafa
+ */ 
+
+#include "stats.h"
+
+#ifdef STATS
+
+#include "serialio.h"
+#include "output.h"
+#include <avr/pgmspace.h>
+
+struct Stat
+{
+	unsigned int count;
+	unsigned long min;
+	unsigned long max;
+	unsigned long sum;
+};
+
+static Stat stats[STAT_POINTS];
+
+const char stat_0[] PROGMEM = "parse    ";
+const char stat_1[] PROGMEM = "db.read  ";
+const char stat_2[] PROGMEM = "db.write ";
+const char stat_3[] PROGMEM = "eep.wait ";
+const char stat_4[] PROGMEM = "uart.tx  ";
+const char stat_5[] PROGMEM = "lcd.bf   ";
+const char stat_6[] PROGMEM = "lcd.char ";
+const char stat_h[] PROGMEM = "point    count min avg max (us)\r";
+
+/* Field names of the records in the kv output mode (output.h). */
+const char key_point[] PROGMEM = "point";
+const char key_count[] PROGMEM = "count";
+const char key_min[]   PROGMEM = "min";
+const char key_avg[]   PROGMEM = "avg";
+const char key_max[]   PROGMEM = "max";
+
+PGM_P const stat_names[] PROGMEM =
+{
+	stat_0,
+	stat_1,
+	stat_2,
+	stat_3,
+	stat_4,
+	stat_5,
+	stat_6
+};
+
+/*
+ * Adds one interval to the given measurement point. The count
+ * saturates instead of wrapping so the average stays meaningful.
+ */
+void STAT::record(byte point, unsigned long ticks)
+{
+	Stat* stat = &stats[point];
+	if (stat->count == 0xFFFF)
+	{
+		return;
+	}
+	if ((stat->count == 0) | (ticks < stat->min))
+	{
+		stat->min = ticks;
+	}
+	if (ticks > stat->max)
+	{
+		stat->max = ticks;
+	}
+	stat->sum += ticks;
+	stat->count++;
+}
+
+void STAT::reset()
+{
+	memset(stats, 0, sizeof(stats));
+}
+
+/*
+ * Prints one line per measurement point on the terminal, or one
+ * point,count,min,avg,max record in the machine-readable modes. This is
+ * the output of the 'stats' command.
+ */
+void STAT::print()
+{
+	/* Copy before printing, printing itself is measured too. */
+	Stat copy[STAT_POINTS];
+	memcpy(copy, stats, sizeof(stats));
+	
+	if (!OUT::text())
+	{
+		for (int p=0; p<STAT_POINTS; p++)
+		{
+			OUT::name(key_point, (PGM_P)pgm_read_word(&stat_names[p]));
+			OUT::field(key_count, copy[p].count);
+			OUT::field(key_min, TIMER::us(copy[p].min));
+			OUT::field(key_avg, copy[p].count ? TIMER::us(copy[p].sum/copy[p].count) : 0);
+			OUT::field(key_max, TIMER::us(copy[p].max));
+			OUT::end();
+		}
+		return;
+	}
+	
+	SIO::pgm_printf(stat_h);
+	for (int p=0; p<STAT_POINTS; p++)
+	{
+		SIO::pgm_printf((PGM_P)pgm_read_word(&stat_names[p]));
+		SIO::printf((long)copy[p].count);
+		SIO::printf(" ");
+		SIO::printf((long)TIMER::us(copy[p].min));
+		SIO::printf(" ");
+		SIO::printf((long)(copy[p].count ? TIMER::us(copy[p].sum/copy[p].count) : 0));
+		SIO::printf(" ");
+		SIO::printf((long)TIMER::us(copy[p].max));
+		SIO::printf("\r");
+	}
+}
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ * timer.cpp
+ *
+ * Created: 10/19/2026 9:13:05 AM
+ *  Author: Usama Mustafa
+ */ 
+
+#include "timer.h"
+
+
+/* Upper 16 bits of the tick counter. */
+static volatile unsigned int overflows = 0;
+
+/* Uptime in seconds and the CPU cycles counted towards the next one. */
+static volatile unsigned long seconds = 0;
+static unsigned long cycles = 0;
+
+ISR(TIMER1_OVF_vect)
+{
+	overflows++;
+	
+	/* One overflow is 65536 ticks of TIMER_PRESCALER cycles each. */
+	cycles += 65536UL*TIMER_PRESCALER;
+	while (cycles >= F_CPU)
+	{
+		cycles -= F_CPU;
+		seconds++;
+	}
+}
+
+/*
+ * Starts Timer1 in normal mode with a prescaler of 8 and enables
+ * the overflow interrupt. Global interrupts are enabled here.
+ */
+void TIMER::Init()
+{
+	TCCR1A = 0x00;
+	TCNT1 = 0;
+	TIMSK1 = (1<<TOIE1);
+	TCCR1B = (1<<CS11);
+	sei();
+}
+
+/*
+ * Returns the current 32-bit tick count. An overflow that happened
+ * after interrupts were disabled, but before the counter was read, is
+ * still pending in TOV1 and has to be accounted for here.
+ */
+unsigned long TIMER::ticks()
+{
+	byte sreg = SREG;
+	cli();
+	unsigned int high = overflows;
+	unsigned int low = TCNT1;
+	if ((TIFR1 & (1<<TOV1)) && (low < 0x8000))
+	{
+		high++;
+	}
+	SREG = sreg;
+	return ((unsigned long)high<<16) | low;
+}
+
+/*
+ * Returns the time since TIMER::Init in whole seconds. Unlike the
+ * tick count this does not wrap for over a hundred years.
+ */
+unsigned long TIMER::uptime()
+{
+	byte sreg = SREG;
+	cli();
+	unsigned long value = seconds;
+	SREG = sreg;
+	return value;
+}
+
+/*
+ * Converts a number of ticks to micro seconds.
+ */
+unsigned long TIMER::us(unsigned long ticks)
+{
+	return ticks * TIMER_PRESCALER / (F_CPU/1000000UL);
+}
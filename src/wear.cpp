@@ -0,0 +1,162 @@
+/*
+ * wear.cpp
+ *
+ * Created: 10/19/2026 8:41:03 PM
+ *  Author: Usama Mustafa
+ */ 
+
+#include "wear.h"
+
+#ifdef WEAR_COUNTERS
+
+#include "eepio.h"
+#include "serialio.h"
+#include "output.h"
+#include <avr/pgmspace.h>
+
+static byte pending[WEAR_REGIONS];
+
+const char wear_h[] PROGMEM = "region writes (% of endurance)\r";
+const char wear_0[] PROGMEM = "hottest ";
+const char wear_1[] PROGMEM = "total ";
+
+/* Field names of the records in the kv output mode (output.h). */
+const char key_region[] PROGMEM = "region";
+const char key_writes[] PROGMEM = "writes";
+
+static unsigned int stored(unsigned int region)
+{
+	unsigned int address = WEAR_BASE+2*region;
+	return 0xFFFF ^ (EEP::Read(address) | ((unsigned int)EEP::Read(address+1)<<8));
+}
+
+/*
+ * Counts one write to the given EEPROM address. Called by EEP::Write
+ * after it has started the write, so a counter update waits for it.
+ */
+void WEAR::Count(unsigned int address)
+{
+	if ((address >= WEAR_BASE) && (address < WEAR_BASE+WEAR_SIZE))
+	{
+		return;
+	}
+	unsigned int region = address/LOAD_OFFSET;
+	if (++pending[region] < WEAR_BATCH)
+	{
+		return;
+	}
+	pending[region] = 0;
+	
+	unsigned int count = stored(region);
+	if (count == 0xFFFF)
+	{
+		return;
+	}
+	count = 0xFFFF ^ (count+1);
+	EEP::Write(WEAR_BASE+2*region, count);
+	EEP::Write(WEAR_BASE+2*region+1, count>>8);
+}
+
+/*
+ * Returns the number of writes counted for the given region since the
+ * counters were erased.
+ */
+unsigned long WEAR::Writes(unsigned int region)
+{
+	return (unsigned long)stored(region)*WEAR_BATCH + pending[region];
+}
+
+/* A region,writes record of the machine-readable modes, the region by
+   its start address in decimal. */
+static void record(unsigned int region, unsigned long writes)
+{
+	OUT::field(key_region, region*LOAD_OFFSET);
+	OUT::field(key_writes, writes);
+	OUT::end();
+}
+
+static void line(unsigned int region, unsigned long writes)
+{
+	SIO::hex((region*LOAD_OFFSET)>>8);
+	SIO::hex(region*LOAD_OFFSET);
+	SIO::printf(" ");
+	SIO::printf((long)writes);
+	SIO::printf(" (");
+	SIO::printf((long)(writes*100/WEAR_ENDURANCE));
+	SIO::printf("%)\r");
+}
+
+/*
+ * Prints the regions that have been written, by start address, and the
+ * one with the most writes. This is the output of the 'wear' command.
+ * The machine-readable modes get a region,writes record per region
+ * written and no hottest line.
+ */
+void WEAR::print()
+{
+	unsigned int hottest = 0;
+	unsigned long most = 0;
+	if (OUT::text())
+	{
+		SIO::pgm_printf(wear_h);
+	}
+	for (unsigned int i=0; i<WEAR_REGIONS; i++)
+	{
+		unsigned long writes = WEAR::Writes(i);
+		if (writes == 0)
+		{
+			continue;
+		}
+		if (!OUT::text())
+		{
+			record(i, writes);
+			continue;
+		}
+		line(i, writes);
+		if (writes > most)
+		{
+			hottest = i;
+			most = writes;
+		}
+	}
+	if (OUT::text())
+	{
+		SIO::pgm_printf(wear_0);
+		line(hottest, most);
+	}
+}
+
+/*
+ * Prints every region as "address,writes" with the address in hex,
+ * followed by "total" and the sum of all writes. This is the output of
+ * 'wear --export', read by database/wear.py. The machine-readable modes
+ * get a region,writes record per region and no total.
+ */
+void WEAR::Export()
+{
+	unsigned long total = 0;
+	for (unsigned int i=0; i<WEAR_REGIONS; i++)
+	{
+		unsigned long writes = WEAR::Writes(i);
+		if (!OUT::text())
+		{
+			record(i, writes);
+			continue;
+		}
+		SIO::hex((i*LOAD_OFFSET)>>8);
+		SIO::hex(i*LOAD_OFFSET);
+		SIO::printf(",");
+		SIO::printf((long)writes);
+		SIO::printf("\r");
+		total += writes;
+	}
+	if (!OUT::text())
+	{
+		return;
+	}
+	SIO::pgm_printf(wear_1);
+	SIO::printf((long)total);
+	SIO::printf("\r");
+}
+
+#endif